@@ -29,6 +29,7 @@ DRAM::DRAM(uint32_t mapping_size)
     }
 
     bank = new uint8_t[mapping_size];
+    ownBank = true;
 
     if(bank == 0)
     {
@@ -54,8 +55,34 @@ DRAM::DRAM(uint32_t mapping_size)
     accessB = 0;
 }
 
+DRAM::DRAM(const DRAM *storage)
+{
+    mappint_size = storage->mappint_size;
+    bank = storage->bank;
+    ownBank = false;
+
+	dw_bit = storage->dw_bit;
+	bank_bit = storage->bank_bit;
+	col_bit = storage->col_bit;
+	row_bit = storage->row_bit;
+	precharge_counter = 0;
+
+    //DRAM Model
+    InitDramController();
+    pre_w_burst = false;
+    pre_r_burst = false;
+    burst_state = NO_BURST;
+
+    //Statstic
+    accessTime = 0;
+    accessB = 0;
+}
+
 DRAM::~DRAM()
 {
+    if(!ownBank)
+        return;
+
     printf("DRAM: precharge_counter = %d\n",precharge_counter);
 
     if(bank != 0)
@@ -122,6 +149,30 @@ bool DRAM::write(uint32_t data, uint32_t addr, int size)
 
     return true;
 }
+/* copy a range of bytes out of the RAM module */
+bool DRAM::readBlock(void* data, uint32_t addr, uint32_t size)
+{
+    if (addr > mappint_size || size > mappint_size - addr) {
+		printf("DRAM: read address out of boundary\n");
+		return false;
+    }
+
+    memcpy(data, ptr_byte(addr), size);
+    return true;
+}
+
+/* copy a range of bytes into the RAM module */
+bool DRAM::writeBlock(const void* data, uint32_t addr, uint32_t size)
+{
+    if (addr > mappint_size || size > mappint_size - addr) {
+		printf("DRAM: write address out of boundary\n");
+		return false;
+    }
+
+    memcpy(ptr_byte(addr), data, size);
+    return true;
+}
+
 void DRAM::InitAddressDecode()
 {
     AddrOffset_Col  = dw_bit;
@@ -351,3 +402,65 @@ bool DRAM::LocalAccess(bool write, uint32_t addr, uint32_t& data, unsigned int l
 
 }
 
+bool DRAM::BurstAccess(bool write, uint32_t addr, uint32_t* data, unsigned int words)
+{
+    if (addr > mappint_size || words > (mappint_size - addr)/4) {
+		printf("DRAM: burst address out of boundary\n");
+		return false;
+    }
+
+    for (unsigned int i=0; i<words; i+=MAX_BURST)
+        BurstTiming(write, addr + i*4, (words-i < MAX_BURST)? words-i : MAX_BURST);
+
+    if(write)
+        memcpy(ptr_byte(addr), data, words*4);
+    else
+        memcpy(data, ptr_byte(addr), words*4);
+
+    return true;
+}
+
+/* Timing of one burst, the closed form of LocalAccess()'s FSM walking over
+ * every word of it. Only the first word and the words opening a new row can
+ * pay for precharge and activation, every other word costs one clock. */
+void DRAM::BurstTiming(bool write, uint32_t addr, unsigned int words)
+{
+    uint32_t last = addr + (words-1)*4;
+
+    accessB += words*4;
+
+#ifdef DDR2
+    if(state == IDLE || NeedPrecharge(addr,100))
+    {
+        accessTime += tRP + tRCD;
+        precharge_counter++;
+        state = write ? WRITE : READ;
+    }
+
+    // An access which does not reopen the row keeps the previous direction.
+    if(state == READ)
+        accessTime += (words > 1 && pre_r_burst) ? DRAM_CLK : CL;
+    else
+        accessTime += (words > 1 && pre_w_burst) ? DRAM_CLK : CWL;
+
+    unsigned int rowCross = ((last & AddrMask_Row) >> AddrOffset_Row) -
+                            ((addr & AddrMask_Row) >> AddrOffset_Row);
+    if(rowCross > 0)
+    {
+        accessTime += rowCross*(tRP + tRCD);
+        precharge_counter += rowCross;
+        state = write ? WRITE : READ;
+    }
+    accessTime += (words-1)*DRAM_CLK;
+
+    burst_state = NO_BURST;
+    if(words == 1)
+        pre_w_burst = pre_r_burst = false;
+    else if(write)
+        pre_w_burst = false;
+    else
+        pre_r_burst = false;
+#endif
+
+    AddrDecode(last);
+}
@@ -17,6 +17,7 @@
 #define tRP         18		// Precharge to Active ns
 #define tRCD        18		// RAS to CAS ns //
 #define DRAM_CLK	1.25	// NS
+#define MAX_BURST   16      // words
 
 inline const uint32_t mask(uint32_t msb, uint32_t lsb)
 {
@@ -41,12 +42,22 @@ class DRAM
 {
     public:
         DRAM(uint32_t mapping_size);
+        /* Timing view: shares the storage of another DRAM but keeps its own
+         * row/burst state and statistic. The storage must outlive the view. */
+        explicit DRAM(const DRAM *storage);
         ~DRAM();
 
         bool read(uint32_t*, uint32_t, int);
         bool write(uint32_t, uint32_t, int);
+        bool readBlock(void*, uint32_t, uint32_t);
+        bool writeBlock(const void*, uint32_t, uint32_t);
         virtual bool LocalAccess(bool write, uint32_t addr, uint32_t& data, unsigned int length,uint32_t burst_length);
 
+        /* Move a run of 32-bit words in bursts of at most MAX_BURST words.
+         * Timing is the same as one LocalAccess() per word, but the model is
+         * updated once per burst. */
+        bool BurstAccess(bool write, uint32_t addr, uint32_t* data, unsigned int words);
+
         //DRAM Model
         void InitDramController();
         bool NeedActive(unsigned int addr);
@@ -60,6 +71,7 @@ class DRAM
 
     	uint32_t mappint_size;
         uint8_t* bank;
+        bool ownBank;
 
 		uint32_t bank_bit;
 		uint32_t row_bit;
@@ -98,6 +110,8 @@ class DRAM
         unsigned int    prev_Bank;
         unsigned int    prev_Row;
 
+        void BurstTiming(bool write, uint32_t addr, unsigned int words);
+
         void InitAddressDecode();
         void AddrDecode(unsigned int addr);
         unsigned int GetMask(unsigned int bit);
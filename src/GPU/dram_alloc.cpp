@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2013, Liou Jhe-Yu <lioujheyu@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ *	@file dram_alloc.cpp
+ *  @brief Device memory allocator implementation
+ */
+
+#include "dram_alloc.h"
+
+DRAMAllocator::DRAMAllocator(uint32_t size, uint32_t align)
+{
+	this->align = align;
+	capacity = size - size%align;
+	liveByte = peakByte = 0;
+	failCnt = 0;
+
+	if (capacity > 0)
+		InsertFree(0, capacity);
+}
+
+int DRAMAllocator::SizeClass(uint32_t size)
+{
+	int c = 0;
+	while (size >>= 1)
+		c++;
+	return c;
+}
+
+void DRAMAllocator::InsertFree(uint32_t addr, uint32_t size)
+{
+	freeBlock[addr] = size;
+	freeList[SizeClass(size)].insert(addr);
+}
+
+void DRAMAllocator::RemoveFree(uint32_t addr, uint32_t size)
+{
+	freeBlock.erase(addr);
+	freeList[SizeClass(size)].erase(addr);
+}
+
+bool DRAMAllocator::Alloc(uint32_t size, uint32_t &addr)
+{
+	if (size == 0)
+		size = align;
+	if (size > capacity) {
+		failCnt++;
+		return false;
+	}
+	size = (size + align - 1) / align * align;
+
+	// First fit in the own class, where a block may still be too small.
+	int c = SizeClass(size);
+	uint32_t blockAddr = 0, blockSize = 0;
+	for (uint32_t a : freeList[c]) {
+		if (freeBlock[a] >= size) {
+			blockAddr = a;
+			blockSize = freeBlock[a];
+			break;
+		}
+	}
+	// Any block of a larger class fits.
+	for (c++; blockSize == 0 && c<CLASS_CNT; c++) {
+		if (!freeList[c].empty()) {
+			blockAddr = *freeList[c].begin();
+			blockSize = freeBlock[blockAddr];
+		}
+	}
+	if (blockSize == 0) {
+		failCnt++;
+		return false;
+	}
+
+	RemoveFree(blockAddr, blockSize);
+	if (blockSize > size)
+		InsertFree(blockAddr + size, blockSize - size);
+
+	usedBlock[blockAddr] = size;
+	liveByte += size;
+	peakByte = (liveByte > peakByte)? liveByte : peakByte;
+	addr = blockAddr;
+	return true;
+}
+
+void DRAMAllocator::Free(uint32_t addr)
+{
+	auto used = usedBlock.find(addr);
+	if (used == usedBlock.end())
+		return;
+
+	uint32_t size = used->second;
+	usedBlock.erase(used);
+	liveByte -= size;
+
+	// Merge with the free neighbours on both sides.
+	auto next = freeBlock.find(addr + size);
+	if (next != freeBlock.end()) {
+		uint32_t nextSize = next->second;
+		RemoveFree(addr + size, nextSize);
+		size += nextSize;
+	}
+	auto prev = freeBlock.lower_bound(addr);
+	if (prev != freeBlock.begin()) {
+		prev--;
+		if (prev->first + prev->second == addr) {
+			uint32_t prevAddr = prev->first;
+			uint32_t prevSize = prev->second;
+			RemoveFree(prevAddr, prevSize);
+			addr = prevAddr;
+			size += prevSize;
+		}
+	}
+	InsertFree(addr, size);
+}
+
+uint32_t DRAMAllocator::BlockSize(uint32_t addr) const
+{
+	auto used = usedBlock.find(addr);
+	return (used == usedBlock.end())? 0 : used->second;
+}
+
+DRAMAllocator::stat DRAMAllocator::Stat() const
+{
+	stat s;
+
+	s.liveByte = liveByte;
+	s.peakByte = peakByte;
+	s.freeByte = capacity - liveByte;
+	s.largestFree = 0;
+	for (auto &it : freeBlock)
+		s.largestFree = (it.second > s.largestFree)? it.second : s.largestFree;
+	s.liveBlock = usedBlock.size();
+	s.freeBlock = freeBlock.size();
+	s.failCnt = failCnt;
+	return s;
+}
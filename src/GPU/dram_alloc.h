@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2013, Liou Jhe-Yu <lioujheyu@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ *	@file dram_alloc.h
+ *  @brief Device memory allocator of the simulated DRAM
+ */
+
+#ifndef DRAM_ALLOC_H_INCLUDED
+#define DRAM_ALLOC_H_INCLUDED
+
+#include <cstdint>
+#include <map>
+#include <set>
+
+/**
+ *	@brief Segregated free list allocator over a DRAM address range
+ *
+ *	Free blocks are kept in one list per power-of-two size class, in address
+ *	order. A request is served first-fit from its own class, or else from the
+ *	first block of a larger class, and the rest of the block is returned to the
+ *	lists. Freed blocks are merged with their free neighbours. Every block size
+ *	and address is a multiple of the alignment.
+ */
+class DRAMAllocator
+{
+public:
+	DRAMAllocator(uint32_t size, uint32_t align);
+
+/**
+ *	Reserve @a size bytes.
+ *	@param addr Start of the block, set only on success
+ *	@return false if no free block is large enough
+ */
+	bool			Alloc(uint32_t size, uint32_t &addr);
+
+///	Return the block starting at @a addr, which must come from Alloc().
+	void			Free(uint32_t addr);
+
+///	Bytes reserved by the block starting at @a addr, 0 if it is not allocated
+	uint32_t		BlockSize(uint32_t addr) const;
+
+	struct stat {
+		uint32_t	liveByte; ///< Reserved by allocated blocks
+		uint32_t	peakByte; ///< Highest liveByte seen
+		uint32_t	freeByte;
+		uint32_t	largestFree; ///< Largest request which can succeed now
+		int			liveBlock;
+		int			freeBlock;
+		int			failCnt; ///< Alloc() calls without a large enough block
+
+	///	1 - largestFree/freeByte. 0 when the free space is in one piece.
+		float		Fragmentation() const
+		{
+			return freeByte == 0 ? 0.0f : 1.0f - (float)largestFree/freeByte;
+		}
+	};
+
+	stat			Stat() const;
+
+private:
+	static const int CLASS_CNT = 32;
+
+	uint32_t		capacity, align;
+	uint32_t		liveByte, peakByte;
+	int				failCnt;
+
+	std::map<uint32_t, uint32_t> freeBlock; ///< Address to size of free blocks
+	std::map<uint32_t, uint32_t> usedBlock; ///< Address to size of allocated blocks
+	std::set<uint32_t> freeList[CLASS_CNT]; ///< Free block addresses by size class
+
+	static int		SizeClass(uint32_t size);
+	void			InsertFree(uint32_t addr, uint32_t size);
+	void			RemoveFree(uint32_t addr, uint32_t size);
+};
+
+#endif // DRAM_ALLOC_H_INCLUDED
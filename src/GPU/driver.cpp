@@ -22,6 +22,23 @@
 
 #include "driver.h"
 
+/// The images of a texture object, in the order of textureObject::dramImage
+static textureImage textureObject::* const texFace[7] = {
+	&textureObject::tex2D,
+	&textureObject::texCubeNX, &textureObject::texCubeNY, &textureObject::texCubeNZ,
+	&textureObject::texCubePX, &textureObject::texCubePY, &textureObject::texCubePZ
+};
+
+/// Draw commands issued so far, the clock of texture eviction
+static uint32_t drawCnt = 0;
+
+/// Texture bytes uploaded, and skipped as already resident, since the last clear
+static uint32_t texUploadByte = 0, texResidentByte = 0;
+static int texEvictCnt = 0; ///< Textures evicted since the last clear
+
+/// The context whose state the GPU holds, see ActiveGPU()
+static Context *gpuCtx = nullptr;
+
 void BilinearFilter4MipMap(textureImage *texImage)
 {
 	uint32_t width, height;
@@ -104,6 +121,7 @@ void GenMipMap(int tid, GLenum target)
 	switch (target) {
 	case GL_TEXTURE_2D:
 		BilinearFilter4MipMap(&ctx->texObjPool[texObjID].tex2D);
+		ctx->texObjPool[texObjID].dirty = true;
 		ctx->texCtx[tid].genMipMap2D = false;
 		break;
 	case GL_TEXTURE_CUBE_MAP:
@@ -113,6 +131,7 @@ void GenMipMap(int tid, GLenum target)
 		BilinearFilter4MipMap(&ctx->texObjPool[texObjID].texCubePX);
 		BilinearFilter4MipMap(&ctx->texObjPool[texObjID].texCubePY);
 		BilinearFilter4MipMap(&ctx->texObjPool[texObjID].texCubePZ);
+		ctx->texObjPool[texObjID].dirty = true;
 		ctx->texCtx[tid].genMipMapCubeMap = false;
 		break;
 	default:
@@ -134,6 +153,12 @@ void ActiveGPU2CleanBuffer()
     gpu.cBufPtr = (uint8_t*)ctx->drawBuffer[0];
     gpu.dBufPtr = (float*)ctx->drawBuffer[1];
 
+	if (texUploadByte + texResidentByte > 0)
+		printf("Texture upload in last frame: %u KB, %u KB already resident, %d evicted\n",
+			   texUploadByte/1024, texResidentByte/1024, texEvictCnt);
+	texUploadByte = texResidentByte = 0;
+	texEvictCnt = 0;
+
     gpu.Run();
 }
 
@@ -429,49 +454,30 @@ uint32_t CopyTexData2Dram (textureImage* tex_ptr, uint32_t dram_ptr)
 	uint32_t pos = dram_ptr;
 	uint32_t pos_tmp;
 	for (int levelCount=0; levelCount<=tex_ptr->maxLevel; levelCount++) {
+		unsigned int width = tex_ptr->widthLevel[levelCount];
+		unsigned int height = tex_ptr->heightLevel[levelCount];
+		const uint8_t *image = tex_ptr->data[levelCount];
 		pos_tmp = pos;
 
 #ifdef IMAGE_MEMORY_OPTIMIZE//Block-based memory rearrangement for 6D cache architecture
-		if (tex_ptr->heightLevel[levelCount] >= TEX_CACHE_BLOCK_SIZE_ROOT) {
-			for (unsigned int y=0; y<tex_ptr->heightLevel[levelCount]; y+=TEX_CACHE_BLOCK_SIZE_ROOT) {
-			for (unsigned int x=0; x<tex_ptr->widthLevel[levelCount]; x+=TEX_CACHE_BLOCK_SIZE_ROOT) {
+		if (height >= TEX_CACHE_BLOCK_SIZE_ROOT) {
+			for (unsigned int y=0; y<height; y+=TEX_CACHE_BLOCK_SIZE_ROOT) {
+			for (unsigned int x=0; x<width; x+=TEX_CACHE_BLOCK_SIZE_ROOT) {
 				for (int t=0; t<TEX_CACHE_BLOCK_SIZE_ROOT; t++) {
-				for (int s=0; s<TEX_CACHE_BLOCK_SIZE_ROOT; s++) {
-
-					uint32_t imagePos = (y + t)*tex_ptr->widthLevel[levelCount] + x+s;
-					gpu.dram.write(*(tex_ptr->data[levelCount] + imagePos*4), pos, 1);
-					gpu.dram.write(*(tex_ptr->data[levelCount] + imagePos*4+1), pos+1, 1);
-					gpu.dram.write(*(tex_ptr->data[levelCount] + imagePos*4+2), pos+2, 1);
-					gpu.dram.write(*(tex_ptr->data[levelCount] + imagePos*4+3), pos+3, 1);
-					pos+=4;
-				}
+					gpu.dram.writeBlock(image + ((y + t)*width + x)*4, pos,
+										TEX_CACHE_BLOCK_SIZE_ROOT*4);
+					pos += TEX_CACHE_BLOCK_SIZE_ROOT*4;
 				}
 			}
 			}
 		}
 		else { //tex_ptr->heightLevel[levelCount] < TEX_CACHE_BLOCK_SIZE_ROOT
-			for (uint32_t dataCount=0;
-				 dataCount<(tex_ptr->heightLevel[levelCount] * tex_ptr->widthLevel[levelCount]);
-				 dataCount++) {
-
-				gpu.dram.write(*(tex_ptr->data[levelCount] + dataCount*4), pos, 1);
-				gpu.dram.write(*(tex_ptr->data[levelCount] + dataCount*4+1), pos+1, 1);
-				gpu.dram.write(*(tex_ptr->data[levelCount] + dataCount*4+2), pos+2, 1);
-				gpu.dram.write(*(tex_ptr->data[levelCount] + dataCount*4+3), pos+3, 1);
-				pos+=4;
-			}
+			gpu.dram.writeBlock(image, pos, width*height*4);
+			pos += width*height*4;
 		}
 #else // No IMAGE_MEMORY_OPTIMIZE
-		for (uint32_t dataCount=0;
-			 dataCount<(tex_ptr->heightLevel[levelCount] * tex_ptr->widthLevel[levelCount]);
-			 dataCount++) {
-
-			gpu.dram.write(*(tex_ptr->data[levelCount] + dataCount*4), pos, 1);
-			gpu.dram.write(*(tex_ptr->data[levelCount] + dataCount*4+1), pos+1, 1);
-			gpu.dram.write(*(tex_ptr->data[levelCount] + dataCount*4+2), pos+2, 1);
-			gpu.dram.write(*(tex_ptr->data[levelCount] + dataCount*4+3), pos+3, 1);
-			pos+=4;
-		}
+		gpu.dram.writeBlock(image, pos, width*height*4);
+		pos += width*height*4;
 #endif // IMAGE_MEMORY_OPTIMIZE
 
 		tex_ptr->data[levelCount] = (uint8_t* )pos_tmp;
@@ -480,34 +486,123 @@ uint32_t CopyTexData2Dram (textureImage* tex_ptr, uint32_t dram_ptr)
 	return pos;
 }
 
-/**	@todo Use link-list or command buffer to set the states only when they
- *	differ from previous context, not all of them.
+static uint32_t TexDataSize(const textureImage *tex)
+{
+	uint32_t size = 0;
+	for (int l=0; l<=tex->maxLevel; l++)
+		size += tex->widthLevel[l] * tex->heightLevel[l] * 4;
+	return size;
+}
+
+void ReleaseTexture(textureObject *texObj)
+{
+	if (texObj->dramSize > 0)
+		gpu.dramAlloc.Free(texObj->dramAddr);
+	texObj->dramSize = 0;
+	texObj->dirty = true;
+}
+
+/**
+ *	Release the least recently drawn resident texture which the current draw
+ *	does not use.
+ *	@return false if there is none
  */
-void ActiveGPU(int vtxInputMode)
+static bool EvictTexture()
 {
-	uint32_t dram_ptr = 0x0;
+	Context *ctx = Context::GetCurrentContext();
+	textureObject *victim = nullptr;
+
+	for (auto &it : ctx->texObjPool) {
+		textureObject *texObj = &it.second;
+		if (texObj->dramSize == 0 || texObj->lastDraw == drawCnt)
+			continue;
+		if (victim == nullptr || texObj->lastDraw < victim->lastDraw)
+			victim = texObj;
+	}
+	if (victim == nullptr)
+		return false;
+
+	ReleaseTexture(victim);
+	texEvictCnt++;
+	return true;
+}
+
+/**
+ *	Upload the images of @a texObj into DRAM unless they are already resident.
+ *	@return false if DRAM has no room for them even after evicting every
+ *	texture which the current draw does not use
+ */
+static bool MakeTexResident(textureObject *texObj)
+{
+	uint32_t size = 0;
+	for (int f=0; f<7; f++)
+		size += TexDataSize(&(texObj->*texFace[f]));
+
+	texObj->lastDraw = drawCnt;
+	if (!texObj->dirty) {
+		texResidentByte += size;
+		return true;
+	}
 
+	// Keep the old address if the new images still fit in it.
+	if (size > texObj->dramSize) {
+		ReleaseTexture(texObj);
+		while (!gpu.dramAlloc.Alloc(size, texObj->dramAddr)) {
+			if (!EvictTexture())
+				return false;
+		}
+		texObj->dramSize = gpu.dramAlloc.BlockSize(texObj->dramAddr);
+	}
+
+	uint32_t pos = texObj->dramAddr;
+	for (int f=0; f<7; f++) {
+		texObj->dramImage[f] = texObj->*texFace[f];
+		pos = CopyTexData2Dram(&texObj->dramImage[f], pos);
+	}
+	texObj->dirty = false;
+	texUploadByte += size;
+	return true;
+}
+
+/**
+ *	Pass the state of the current context to the GPU and run the draw command.
+ *	Only the state groups marked in Context::dirtyState are passed, the GPU
+ *	keeps the rest from the previous draw. Instruction pools are bound to the
+ *	linked program, which stays alive until the next LinkProgram() marks
+ *	DIRTY_PROGRAM.
+ */
+void ActiveGPU(int vtxInputMode)
+{
     Context *ctx = Context::GetCurrentContext();
     programObject *t_program = &ctx->programPool[ctx->usePID];
 
-	std::vector<scalarInstruction> scalarISpool;
+	drawCnt++;
 
-    for (int i=0;i<MAX_TEXTURE_CONTEXT;i++){
-		if (ctx->texCtx[i].genMipMap2D)
-			GenMipMap(i, GL_TEXTURE_2D);
-		if (ctx->texCtx[i].genMipMapCubeMap)
-			GenMipMap(i, GL_TEXTURE_CUBE_MAP);
-    }
+	// The GPU holds the state of another context
+	if (ctx != gpuCtx) {
+		ctx->dirtyState = DIRTY_ALL;
+		gpuCtx = ctx;
+	}
+	uint32_t dirty = ctx->dirtyState;
+
+	if (dirty & DIRTY_TEXTURE) {
+		for (int i=0;i<MAX_TEXTURE_CONTEXT;i++){
+			if (ctx->texCtx[i].genMipMap2D)
+				GenMipMap(i, GL_TEXTURE_2D);
+			if (ctx->texCtx[i].genMipMapCubeMap)
+				GenMipMap(i, GL_TEXTURE_CUBE_MAP);
+		}
+	}
 
-    for (int i=0;i<MAX_ATTRIBUTE_NUMBER;i++){
-        gpu.attrEnable[i] = ctx->vertexAttrib[i].enable;
-        if(ctx->vertexAttrib[i].enable){
-            gpu.vtxPointer[i] = ctx->vertexAttrib[i].ptr;
-            gpu.attrSize[i] = ctx->vertexAttrib[i].size;
-        }
-        gpu.varyEnable[i] = t_program->varyEnable[i];
-        gpu.varyInterpMode[i] = t_program->varyInterpMode[i];
-    }
+	if (dirty & DIRTY_VERTEX_ARRAY) {
+		for (int i=0;i<MAX_ATTRIBUTE_NUMBER;i++){
+			gpu.attrEnable[i] = ctx->vertexAttrib[i].enable;
+			if(ctx->vertexAttrib[i].enable){
+				gpu.vtxPointer[i] = ctx->vertexAttrib[i].ptr;
+				gpu.attrSize[i] = ctx->vertexAttrib[i].size;
+			}
+		}
+	}
 
     gpu.drawMode = ctx->drawCmd.mode;
     gpu.vtxCount = ctx->drawCmd.count;
@@ -523,78 +618,89 @@ void ActiveGPU(int vtxInputMode)
 
 	gpu.clearStat = ctx->clearStat;
 	gpu.clearMask = ctx->clearMask;
+    gpu.cBufPtr = (uint8_t*)ctx->drawBuffer[0];
+    gpu.dBufPtr = (float*)ctx->drawBuffer[1];
 
-	gpu.viewPortLX = ctx->vp.x;
-    gpu.viewPortLY = ctx->vp.y;
-    gpu.viewPortW = ctx->vp.w;
-    gpu.viewPortH = ctx->vp.h;
-    gpu.depthRangeN = ctx->vp.n;
-    gpu.depthRangeF = ctx->vp.f;
-
-    gpu.cullingEnable = ctx->cullingEnable;
-    if (ctx->frontFace == GL_CCW)
-		gpu.cullFaceMode = ctx->cullFaceMode;
-	else if (ctx->frontFace == GL_CW) {
-		if (ctx->cullFaceMode == GL_FRONT)
-			gpu.cullFaceMode = GL_BACK;
-		else if (ctx->cullFaceMode == GL_BACK)
-			gpu.cullFaceMode = GL_FRONT;
-		else
-			gpu.cullFaceMode = ctx->cullFaceMode;
+	if (dirty & DIRTY_VIEWPORT) {
+		gpu.viewPortLX = ctx->vp.x;
+		gpu.viewPortLY = ctx->vp.y;
+		gpu.viewPortW = ctx->vp.w;
+		gpu.viewPortH = ctx->vp.h;
+		gpu.depthRangeN = ctx->vp.n;
+		gpu.depthRangeF = ctx->vp.f;
 	}
 
-    gpu.blendEnable = ctx->blendEnable;
-    gpu.depthTestEnable = ctx->depthTestEnable;
-    gpu.cBufPtr = (uint8_t*)ctx->drawBuffer[0];
-    gpu.dBufPtr = (float*)ctx->drawBuffer[1];
+	if (dirty & DIRTY_RASTER) {
+		gpu.cullingEnable = ctx->cullingEnable;
+		if (ctx->frontFace == GL_CCW)
+			gpu.cullFaceMode = ctx->cullFaceMode;
+		else if (ctx->frontFace == GL_CW) {
+			if (ctx->cullFaceMode == GL_FRONT)
+				gpu.cullFaceMode = GL_BACK;
+			else if (ctx->cullFaceMode == GL_BACK)
+				gpu.cullFaceMode = GL_FRONT;
+			else
+				gpu.cullFaceMode = ctx->cullFaceMode;
+		}
+
+		gpu.blendEnable = ctx->blendEnable;
+		gpu.depthTestEnable = ctx->depthTestEnable;
+	}
 
     //Texture Statement
+	uint32_t uploadByte = texUploadByte, residentByte = texResidentByte;
     for (int i=0; i<t_program->texCnt; i++){
-		gpu.minFilter[i] = ctx->texCtx[ctx->samplePool[i]].minFilter;
-		gpu.magFilter[i] = ctx->texCtx[ctx->samplePool[i]].magFilter;
-		gpu.wrapS[i] = ctx->texCtx[ctx->samplePool[i]].wrapS;
-		gpu.wrapT[i] = ctx->texCtx[ctx->samplePool[i]].wrapT;
-		gpu.maxAnisoFilterRatio = ctx->texCtx[ctx->samplePool[i]].maxAnisoFilterRatio;
-		gpu.tex2D[i] = ctx->texObjPool[ ctx->texCtx[ctx->samplePool[i]].texObjBindID ].tex2D;
-		dram_ptr = CopyTexData2Dram(&gpu.tex2D[i], dram_ptr);
-		gpu.texCubeNX[i] = ctx->texObjPool[ ctx->texCtx[ctx->samplePool[i]].texObjBindID ].texCubeNX;
-		dram_ptr = CopyTexData2Dram(&gpu.texCubeNX[i], dram_ptr);
-		gpu.texCubeNY[i] = ctx->texObjPool[ ctx->texCtx[ctx->samplePool[i]].texObjBindID ].texCubeNY;
-		dram_ptr = CopyTexData2Dram(&gpu.texCubeNY[i], dram_ptr);
-		gpu.texCubeNZ[i] = ctx->texObjPool[ ctx->texCtx[ctx->samplePool[i]].texObjBindID ].texCubeNZ;
-		dram_ptr = CopyTexData2Dram(&gpu.texCubeNZ[i], dram_ptr);
-		gpu.texCubePX[i] = ctx->texObjPool[ ctx->texCtx[ctx->samplePool[i]].texObjBindID ].texCubePX;
-		dram_ptr = CopyTexData2Dram(&gpu.texCubePX[i], dram_ptr);
-		gpu.texCubePY[i] = ctx->texObjPool[ ctx->texCtx[ctx->samplePool[i]].texObjBindID ].texCubePY;
-		dram_ptr = CopyTexData2Dram(&gpu.texCubePY[i], dram_ptr);
-		gpu.texCubePZ[i] = ctx->texObjPool[ ctx->texCtx[ctx->samplePool[i]].texObjBindID ].texCubePZ;
-		dram_ptr = CopyTexData2Dram(&gpu.texCubePZ[i], dram_ptr);
-    }
+		const textureContext &texCtx = ctx->texCtx[ctx->samplePool[i]];
+		if (dirty & DIRTY_TEXTURE) {
+			gpu.minFilter[i] = texCtx.minFilter;
+			gpu.magFilter[i] = texCtx.magFilter;
+			gpu.wrapS[i] = texCtx.wrapS;
+			gpu.wrapT[i] = texCtx.wrapT;
+			gpu.maxAnisoFilterRatio = texCtx.maxAnisoFilterRatio;
+		}
 
-    for (int i=0; i<t_program->uniformCnt; i++)
-		gpu.uniformPool[i] = ctx->uniformPool[i];
+		// Residency is checked on every draw, since another draw may evict it.
+		textureObject *texObj = &ctx->texObjPool[texCtx.texObjBindID];
+		if (!MakeTexResident(texObj)) {
+			fprintf(stderr, "Driver: textures of this draw exceed %d KB of DRAM\n",
+					DRAM_SIZE/1024);
+			exit(1);
+		}
+		gpu.tex2D[i] = texObj->dramImage[0];
+		gpu.texCubeNX[i] = texObj->dramImage[1];
+		gpu.texCubeNY[i] = texObj->dramImage[2];
+		gpu.texCubeNZ[i] = texObj->dramImage[3];
+		gpu.texCubePX[i] = texObj->dramImage[4];
+		gpu.texCubePY[i] = texObj->dramImage[5];
+		gpu.texCubePZ[i] = texObj->dramImage[6];
+    }
 
-/*	Unsure shall we copy whole instruction into GPU or just use pointer to
- *	get instruction from outside
- */
-	gpu.VSinstCnt = t_program->VSinstructionPool.size();
-	gpu.VSinstPool = new instruction[gpu.VSinstCnt];
-	for (int i=0; i<gpu.VSinstCnt; i++) {
-		*(gpu.VSinstPool + i) = t_program->VSinstructionPool[i];
-		//NVGP4toScalar(t_program->VSinstructionPool[i], &scalarISpool);
+	if (dirty & DIRTY_UNIFORM) {
+		for (int i=0; i<t_program->uniformCnt; i++)
+			gpu.uniformPool[i] = ctx->uniformPool[i];
 	}
 
-	gpu.FSinstCnt = t_program->FSinstructionPool.size();
-	gpu.FSinstPool = new instruction[gpu.FSinstCnt];
-	for (int i=0; i<gpu.FSinstCnt; i++) {
-		*(gpu.FSinstPool + i) = t_program->FSinstructionPool[i];
-		//NVGP4toScalar(t_program->FSinstructionPool[i], &scalarISpool);
+	if (dirty & DIRTY_PROGRAM) {
+		for (int i=0;i<MAX_ATTRIBUTE_NUMBER;i++){
+			gpu.varyEnable[i] = t_program->varyEnable[i];
+			gpu.varyInterpMode[i] = t_program->varyInterpMode[i];
+		}
+		gpu.varyRead = t_program->FSattrRead;
+
+		gpu.VSinstCnt = t_program->VSinstructionPool.size();
+		gpu.VSinstPool = t_program->VSinstructionPool.data();
+		gpu.FSinstCnt = t_program->FSinstructionPool.size();
+		gpu.FSinstPool = t_program->FSinstructionPool.data();
+		gpu.VSjit = t_program->VSjit.get();
+		gpu.FSjit = t_program->FSjit.get();
+		gpu.FSrunLane = t_program->FSrunLane.data();
 	}
+	gpu.programDirty = dirty & (DIRTY_PROGRAM | DIRTY_UNIFORM);
+	ctx->dirtyState = 0;
 
-	printf("On-board Memory usage: %d KB\n",dram_ptr/1024);
+	printf("On-board Memory usage: %u KB, texture upload %u KB, %u KB already resident\n",
+		   gpu.dramAlloc.Stat().liveByte/1024, (texUploadByte - uploadByte)/1024,
+		   (texResidentByte - residentByte)/1024);
 
     gpu.Run();
-
-    delete [] gpu.VSinstPool;
-    delete [] gpu.FSinstPool;
 }
@@ -23,6 +23,8 @@
 
 #define NO_MODIFIER -1
 
+struct textureObject;
+
 /**
  *  Write All context status into GPU, and then activate GPU.
  *  @param vtxInputMode This active command is drawArray or drawElement
@@ -58,5 +60,11 @@ int NVGP4toScalar(instruction in, std::vector<scalarInstruction> *ISpool);
  */
 uint32_t CopyTexData2Dram (textureImage* tex_ptr, uint32_t dram_ptr);
 
+/**
+ *	Give the DRAM of a resident texture object back to the allocator. It is
+ *	uploaded again the next time a draw uses it.
+ */
+void ReleaseTexture(textureObject *texObj);
+
 
 #endif // DRIVER_H_INCLUDED
@@ -21,6 +21,8 @@
  */
 
 #include "gpu_core.h"
+#include "simd_lane.h"
+#include <cfloat>
 
 void GPU_Core::InitPrimitiveAssembly()
 {
@@ -45,23 +47,111 @@ void GPU_Core::InitPrimitiveAssembly()
 /****** Grahphic Related Function ******/
 
 /**
- *	Invoke specified Shader Core for vertex shader processing
+ *	Dispatch a vertex batch to an idle Shader Core. Each vertex occupies one
+ *	execution unit, so a batch up to \ref SHADER_EXECUNIT vertices is shaded in
+ *	a single pass over the instruction pool.
  *
- *	@param sid Which shader core id will be used.
- *	@param input Input pointer
+ *	@param vtx Input vertex array, also receives the shaded result.
+ *	@param vtxCnt How many vertices are in vtx.
  */
+void GPU_Core::VertexShaderEXE(vertex *vtx, int vtxCnt)
+{
+	int cid = AcquireShaderCore();
+	ShaderCore *core = sCore[cid];
+	int instCnt = core->totalInstructionCnt;
+	int scaleOp = core->totalScaleOperation;
+
+	core->instPool = VSinstPool;
+	core->decPool = VSdecPool.data();
+	core->jit = (shaderEngine == SHADER_ENGINE_JIT)? VSjit : nullptr;
+	core->jitConst = VSjitConst.data();
+	core->instCnt = VSinstCnt;
+	core->uniformPool = uniformPool;
+	core->texUnit.cache = vsTexCache;
+
+	core->Init();
+	for (int i=0; i<vtxCnt; i++) {
+		core->isEnable[i] = true;
+		core->threadPtr[i] = vtx + i;
+	}
+	core->Run();
+
+	core->vertexBatchCnt++;
+	vsInstructionCnt += core->totalInstructionCnt - instCnt;
+	vsScaleOperation += core->totalScaleOperation - scaleOp;
+	ReleaseShaderCore(cid);
+}
 
-///@todo Raise the usage of 4 exec units.
-void GPU_Core::VertexShaderEXE(int sid, vertex *vtx)
+void GPU_Core::ShadeVertexBatch(int vBase, int vtxCnt)
 {
-	sCore[sid].instPool = VSinstPool;
-	sCore[sid].instCnt = VSinstCnt;
-	sCore[sid].uniformPool = uniformPool;
-
-	sCore[sid].Init();
-	sCore[sid].isEnable[0] = true;
-	sCore[sid].threadPtr[0] = vtx;
-	sCore[sid].Run();
+	int i, slot, laneCnt = 0;
+	int srcLane[SHADER_EXECUNIT];
+	uint32_t vIdx;
+
+	if (vtxInputMode == 0 || vtxCacheSize <= 0) {
+		for (i=0; i<vtxCnt; i++)
+			FetchVertexData(GetVertexIndex(vBase + i), &vtxBatch[i]);
+
+		VertexShaderEXE(vtxBatch, vtxCnt);
+		return;
+	}
+
+	for (i=0; i<vtxCnt; i++) {
+		vIdx = GetVertexIndex(vBase + i);
+
+		std::unordered_map<uint32_t, int>::iterator it = vtxCacheMap.find(vIdx);
+		if (it != vtxCacheMap.end()) {
+			vtxCacheHit++;
+			if (vtxCache[it->second].lane >= 0) //Still waiting for shading
+				srcLane[i] = vtxCache[it->second].lane;
+			else {
+				srcLane[i] = -1;
+				vtxBatch[i] = vtxCache[it->second].vtx;
+			}
+			continue;
+		}
+
+		vtxCacheMiss++;
+		FetchVertexData(vIdx, &vtxShadeBuf[laneCnt]);
+
+		if (vtxCachePolicy == VTX_CACHE_PERFECT ||
+			(int)vtxCache.size() < vtxCacheSize) {
+			slot = vtxCache.size();
+			vtxCache.push_back(vtxCacheEntry());
+		}
+		else { //Replace the oldest entry
+			slot = vtxCacheHead;
+			vtxCacheHead = (vtxCacheHead + 1) % vtxCacheSize;
+			vtxCacheMap.erase(vtxCache[slot].idx);
+		}
+		vtxCache[slot].idx = vIdx;
+		vtxCache[slot].lane = laneCnt;
+		vtxCacheMap[vIdx] = slot;
+
+		srcLane[i] = laneCnt++;
+	}
+
+	if (laneCnt > 0)
+		VertexShaderEXE(vtxShadeBuf, laneCnt);
+
+	for (i=0; i<(int)vtxCache.size(); i++) {
+		if (vtxCache[i].lane >= 0) {
+			vtxCache[i].vtx = vtxShadeBuf[vtxCache[i].lane];
+			vtxCache[i].lane = -1;
+		}
+	}
+
+	for (i=0; i<vtxCnt; i++) {
+		if (srcLane[i] >= 0)
+			vtxBatch[i] = vtxShadeBuf[srcLane[i]];
+	}
+}
+
+void GPU_Core::ClearVertexCache()
+{
+	vtxCache.clear();
+	vtxCacheMap.clear();
+	vtxCacheHead = 0;
 }
 
 void GPU_Core::PerspectiveDivision(vertex *vtx)
@@ -96,12 +186,17 @@ void GPU_Core::ViewPort(vertex *vtx)
     y = y*viewPortH/2 + viewPortLY + viewPortH/2;
     z = z*(depthRangeF-depthRangeN)/2 + (depthRangeF+depthRangeN)/2;
 
+    if (fixedPointRaster) {
+        x = std::round(x*(1<<SUBPIXEL_BITS)) / (1<<SUBPIXEL_BITS);
+        y = std::round(y*(1<<SUBPIXEL_BITS)) / (1<<SUBPIXEL_BITS);
+    }
+
     vtx->attr[0].x = x;
     vtx->attr[0].y = y;
     vtx->attr[0].z = z;
 }
 
-void GPU_Core::PrimitiveAssembly()
+bool GPU_Core::PrimitiveAssembly()
 {
     switch (drawMode) {
     case GL_TRIANGLES:
@@ -187,155 +282,247 @@ void GPU_Core::PrimitiveAssembly()
 		}
 
         totalProcessingPrimitive++;
-        primFIFO.push(curPrim);
+        return true;
     }
+    return false;
 }
 
-void GPU_Core::Clipping()
+/**
+ *	Outcodes of the three vertices of @a p, with the vertices in SIMD lanes.
+ *	@a frustum holds the CLIP_* planes each vertex is outside of, and @a guard
+ *	the same with the side planes moved out to @a band viewports.
+ */
+static void ClipOutcode(const primitive &p, float band, int frustum[3], int guard[3])
 {
-	bool outsideClipVolume = false;
-	int next;
-	float outRatio, outPart, inPart;
-	bool outsideZNear[3];
-
-	primitive newPrim;
-	vertex newVtx;
-	std::stack<vertex> vtxStack;
-
-	outsideZNear[0] = outsideZNear[1] = outsideZNear[2] = false;
-
-	//Check if the primitive is completely outside the clip volume.
-	outsideClipVolume = ((prim.v[0].attr[0].x > prim.v[0].attr[0].w) &&
-						 (prim.v[1].attr[0].x > prim.v[1].attr[0].w) &&
-						 (prim.v[2].attr[0].x > prim.v[2].attr[0].w)
-						) ||
-						((prim.v[0].attr[0].y > prim.v[0].attr[0].w) &&
-						 (prim.v[1].attr[0].y > prim.v[1].attr[0].w) &&
-						 (prim.v[2].attr[0].y > prim.v[2].attr[0].w)
-						) ||
-						((prim.v[0].attr[0].z > prim.v[0].attr[0].w) &&
-						 (prim.v[1].attr[0].z > prim.v[1].attr[0].w) &&
-						 (prim.v[2].attr[0].z > prim.v[2].attr[0].w)
-						) ||
-						((prim.v[0].attr[0].x < -prim.v[0].attr[0].w) &&
-						 (prim.v[1].attr[0].x < -prim.v[1].attr[0].w) &&
-						 (prim.v[2].attr[0].x < -prim.v[2].attr[0].w)
-						) ||
-						((prim.v[0].attr[0].y < -prim.v[0].attr[0].w) &&
-						 (prim.v[1].attr[0].y < -prim.v[1].attr[0].w) &&
-						 (prim.v[2].attr[0].y < -prim.v[2].attr[0].w)
-						) ||
-						((prim.v[0].attr[0].z < -prim.v[0].attr[0].w) &&
-						 (prim.v[1].attr[0].z < -prim.v[1].attr[0].w) &&
-						 (prim.v[2].attr[0].z < -prim.v[2].attr[0].w)
-						);
-	if (outsideClipVolume) { //Completely outside the clip volume
+	float x[3+SHADER_SOA_WIDTH], y[3+SHADER_SOA_WIDTH];
+	float z[3+SHADER_SOA_WIDTH], w[3+SHADER_SOA_WIDTH];
+	int i, k, l;
+
+	for (i=0; i<3+SHADER_SOA_WIDTH; i++) {
+		const floatVec4 &pos = p.v[(i<3)? i : 0].attr[0];
+		x[i] = pos.x;	y[i] = pos.y;	z[i] = pos.z;	w[i] = pos.w;
+	}
+
+	for (l=0; l<3; l+=SHADER_SOA_WIDTH) {
+		lanef vx = laneLoad(x+l), vy = laneLoad(y+l), vz = laneLoad(z+l);
+		lanef vw = laneLoad(w+l), nw = laneNeg(vw);
+		lanef bw = laneMul(vw, laneSet(band)), nbw = laneNeg(bw);
+		int bits[10] = {
+			laneBits(laneLt(vz, nw)),	laneBits(laneGt(vz, vw)),
+			laneBits(laneLt(vx, nw)),	laneBits(laneGt(vx, vw)),
+			laneBits(laneLt(vy, nw)),	laneBits(laneGt(vy, vw)),
+			laneBits(laneLt(vx, nbw)),	laneBits(laneGt(vx, bw)),
+			laneBits(laneLt(vy, nbw)),	laneBits(laneGt(vy, bw)) };
+
+		for (i=0; i<SHADER_SOA_WIDTH && l+i<3; i++) {
+			frustum[l+i] = guard[l+i] = 0;
+			for (k=0; k<6; k++)
+				frustum[l+i] |= ((bits[k]>>i) & 1) << k;
+			for (k=0; k<2; k++)
+				guard[l+i] |= ((bits[k]>>i) & 1) << k;
+			for (k=2; k<6; k++)
+				guard[l+i] |= ((bits[k+4]>>i) & 1) << k;
+		}
+	}
+}
+
+/// Signed distance of @a pos to clip plane @a plane, not negative inside
+static inline float ClipDistance(const floatVec4 &pos, int plane)
+{
+	switch (plane) {
+	case CLIP_NEAR:		return pos.w + pos.z;
+	case CLIP_FAR:		return pos.w - pos.z;
+	case CLIP_LEFT:		return pos.w + pos.x;
+	case CLIP_RIGHT:	return pos.w - pos.x;
+	case CLIP_BOTTOM:	return pos.w + pos.y;
+	default:			return pos.w - pos.y;
+	}
+}
+
+int GPU_Core::Clipping()
+{
+	int frustum[3], guard[3];
+	int i, j, next, plane;
+
+	ClipOutcode(curPrim, guardBand, frustum, guard);
+
+	//Completely outside one plane of the clip volume
+	if (frustum[0] & frustum[1] & frustum[2]) {
 		totalCulledPrimitive++;
-		prim.iskilled = true;
-		return;
+		return 0;
 	}
 
-	//Check if this primitive intersects zNear plane.
-	for (int i=0; i<3; i++) {
-		if ( prim.v[i].attr[0].z < -prim.v[i].attr[0].w )
-			outsideZNear[i] = true;
+	int clipPlane = guard[0] | guard[1] | guard[2];
+	if (clipPlane == 0) {
+		clipPrim[0] = curPrim;
+		return 1;
 	}
-	//Clip the primitive if one of the previous tests is true.
-	if (outsideZNear[0] || outsideZNear[1] || outsideZNear[2]) {
-		totalClippedPrimitive++;
 
-		newPrim.isGenerated = true;
+	totalClippedPrimitive++;
+	if (clipPlane & ~(CLIP_NEAR | CLIP_FAR))
+		guardBandClipCnt++;
 
-		for (int i=0; i<3; i++) {
-			next = (i==2)? 0 : (i+1); // (i+1) mod 3
 /*
- *	Sutherland-Hodgman Polygon Clipping Algorithm
+ *	Sutherland-Hodgman Polygon Clipping Algorithm, one plane after another.
+ *	Both polygons live on the stack; a triangle gains at most one vertex from
+ *	each plane.
  */
+	vertex poly[2][CLIP_VERTEX_MAX];
+	bool inside[CLIP_VERTEX_MAX];
+	float dist[CLIP_VERTEX_MAX];
+	float outRatio, outPart, inPart;
+	int src = 0, vtxCnt = 3, newCnt;
+
+	for (i=0; i<3; i++)
+		poly[0][i] = curPrim.v[i];
+
+	for (plane=CLIP_NEAR; plane<=CLIP_TOP; plane<<=1) {
+		if ((clipPlane & plane) == 0)
+			continue;
+
+		const vertex *in = poly[src];
+		vertex *out = poly[src^1];
+
+		for (i=0; i<vtxCnt; i++) {
+			dist[i] = ClipDistance(in[i].attr[0], plane);
+			inside[i] = !(dist[i] < 0);
+		}
+
+		newCnt = 0;
+		for (i=0; i<vtxCnt; i++) {
+			next = (i==vtxCnt-1)? 0 : (i+1); // (i+1) mod vtxCnt
 			// in-to-in
-			if (outsideZNear[i]==false && outsideZNear[next]==false)
-				vtxStack.push(prim.v[next]);
+			if (inside[i] && inside[next])
+				out[newCnt++] = in[next];
 			// out-to-out
-			else if (outsideZNear[i]==true && outsideZNear[next]==true)
+			else if (!inside[i] && !inside[next])
 				continue;
 			// in-to-out (i:in, next:out)
-			else if (outsideZNear[i]==false && outsideZNear[next]==true) {
+			else if (inside[i]) {
 ///	@bug the varying result after clipping is incorrect when noperspective is enable.
-				outPart = fabs(prim.v[next].attr[0].w + prim.v[next].attr[0].z);
-				inPart = fabs(prim.v[i].attr[0].w + prim.v[i].attr[0].z);
+				outPart = fabs(dist[next]);
+				inPart = fabs(dist[i]);
 				outRatio = outPart / (outPart + inPart);
 
-				for (int j=0; j<MAX_ATTRIBUTE_NUMBER; j++) {
+				for (j=0; j<MAX_ATTRIBUTE_NUMBER; j++) {
 					if (varyEnable[j]) {
-						newVtx.attr[j] = prim.v[next].attr[j]*(1-outRatio) +
-										 prim.v[i].attr[j]*outRatio;
+						out[newCnt].attr[j] = in[next].attr[j]*(1-outRatio) +
+											  in[i].attr[j]*outRatio;
 					}
 				}
-
-				vtxStack.push(newVtx);
+				newCnt++;
 			}
 			// out-to-in (i:out, next:in)
 			else {
-				outPart = fabs(prim.v[i].attr[0].w + prim.v[i].attr[0].z);
-				inPart = fabs(prim.v[next].attr[0].w + prim.v[next].attr[0].z);
+				outPart = fabs(dist[i]);
+				inPart = fabs(dist[next]);
 				outRatio = outPart / (outPart + inPart);
 
-				for (int j=0; j<MAX_ATTRIBUTE_NUMBER; j++) {
+				for (j=0; j<MAX_ATTRIBUTE_NUMBER; j++) {
 					if (varyEnable[j]) {
-						newVtx.attr[j] = prim.v[i].attr[j]*(1-outRatio) +
-										 prim.v[next].attr[j]*outRatio;
+						out[newCnt].attr[j] = in[i].attr[j]*(1-outRatio) +
+											  in[next].attr[j]*outRatio;
 					}
 				}
-
-				vtxStack.push(newVtx);
-				vtxStack.push(prim.v[next]);
+				newCnt++;
+				out[newCnt++] = in[next];
 			}
 		}
 
-		//Assemble vertex into primitive from vtxStack (GL_TRIANGLE_FAN mode)
-		newPrim.v[2] = vtxStack.top(); vtxStack.pop();
-		newPrim.v[0] = vtxStack.top();	vtxStack.pop();
-		while (!vtxStack.empty()) {
-			newPrim.v[1] = newPrim.v[0];
-			newPrim.v[0] = vtxStack.top(); vtxStack.pop();
-
-			primFIFO.push(newPrim);
-			totalGeneratedPrimitive++;
-			totalProcessingPrimitive++;
+		vtxCnt = newCnt;
+		src ^= 1;
+		if (vtxCnt < 3) {
+			totalCulledPrimitive++;
+			return 0;
 		}
+	}
 
-		prim.iskilled = true;
+	//Assemble the polygon into a triangle fan around its last vertex
+	const vertex *fan = poly[src];
+	int primCnt = 0;
+	for (i=vtxCnt-3; i>=0; i--) {
+		clipPrim[primCnt].v[0] = fan[i];
+		clipPrim[primCnt].v[1] = fan[i+1];
+		clipPrim[primCnt].v[2] = fan[vtxCnt-1];
+		primCnt++;
 	}
+
+	totalGeneratedPrimitive += primCnt;
+	totalProcessingPrimitive += primCnt;
+	return primCnt;
 }
 
 void GPU_Core::TriangleSetup()
 {
 	float doubleArea;
 
-	Edge[0][0] = prim.v[0].attr[0].y - prim.v[1].attr[0].y;
-	Edge[0][1] = prim.v[0].attr[0].x - prim.v[1].attr[0].x;
-	Edge[1][0] = prim.v[1].attr[0].y - prim.v[2].attr[0].y;
-	Edge[1][1] = prim.v[1].attr[0].x - prim.v[2].attr[0].x;
-	Edge[2][0] = prim.v[2].attr[0].y - prim.v[0].attr[0].y;
-	Edge[2][1] = prim.v[2].attr[0].x - prim.v[0].attr[0].x;
+	prim.Edge[0][0] = prim.v[0].attr[0].y - prim.v[1].attr[0].y;
+	prim.Edge[0][1] = prim.v[0].attr[0].x - prim.v[1].attr[0].x;
+	prim.Edge[1][0] = prim.v[1].attr[0].y - prim.v[2].attr[0].y;
+	prim.Edge[1][1] = prim.v[1].attr[0].x - prim.v[2].attr[0].x;
+	prim.Edge[2][0] = prim.v[2].attr[0].y - prim.v[0].attr[0].y;
+	prim.Edge[2][1] = prim.v[2].attr[0].x - prim.v[0].attr[0].x;
 
-	doubleArea = Edge[0][1]*Edge[1][0] - Edge[0][0]*Edge[1][1];
+	doubleArea = prim.Edge[0][1]*prim.Edge[1][0] - prim.Edge[0][0]*prim.Edge[1][1];
 
-	area2Reciprocal = 1/doubleArea;
+	prim.area2Reciprocal = 1/doubleArea;
 
-	LY = MIN3(prim.v[0].attr[0].y, prim.v[1].attr[0].y, prim.v[2].attr[0].y);
-	LY = CLAMP(LY, viewPortLY, viewPortLY+viewPortH-1);
+/*	Depth of a covered pixel is v0 + b0*A + b1*B, with A and B as in
+ *	AttribPlaneSetup() and b0, b1 >= 0, b0 + b1 <= 1 after EmitQuad() clamps
+ *	them. Its exact value is then no less than the smallest of v0, v0+A and
+ *	v0+B. The float operations on either side, including the clamp, are
+ *	fewer than eight and each rounds by at most FLT_EPSILON/2 of |v0|+|A|+|B|.
+ *	Four FLT_EPSILON of that covers them all, so hierarchical Z never rejects
+ *	a pixel which passes the depth test.
+ */
+	const float z0 = prim.v[0].attr[0].z;
+	const float zA = prim.v[1].attr[0].z - z0, zB = prim.v[2].attr[0].z - z0;
+	prim.zMin = z0 + std::min(0.0f, std::min(zA, zB)) -
+				(std::fabs(z0) + std::fabs(zA) + std::fabs(zB))*4*FLT_EPSILON;
+
+	prim.LY = MIN3(prim.v[0].attr[0].y, prim.v[1].attr[0].y, prim.v[2].attr[0].y);
+	prim.LY = CLAMP(prim.LY, viewPortLY, viewPortLY+viewPortH-1);
 /*	Align boundary box onto even coordinate to make sure the tile split will not
  *	output any 2x2 pixel quad outside the HY and RX boundary.
  */
-	LY = LY & 0xfffe;
-	LX = MIN3(prim.v[0].attr[0].x, prim.v[1].attr[0].x, prim.v[2].attr[0].x);
-	LX = CLAMP(LX, viewPortLX, viewPortLX+viewPortW-1);
+	prim.LY = prim.LY & 0xfffe;
+	prim.LX = MIN3(prim.v[0].attr[0].x, prim.v[1].attr[0].x, prim.v[2].attr[0].x);
+	prim.LX = CLAMP(prim.LX, viewPortLX, viewPortLX+viewPortW-1);
 //  So does x-axis
-	LX = LX & 0xfffe;
-	HY = MAX3(prim.v[0].attr[0].y, prim.v[1].attr[0].y, prim.v[2].attr[0].y);
-	HY = CLAMP(HY, viewPortLY, viewPortLY+viewPortH-1);
-	RX = MAX3(prim.v[0].attr[0].x, prim.v[1].attr[0].x, prim.v[2].attr[0].x);
-	RX = CLAMP(RX, viewPortLX, viewPortLX+viewPortW-1);
+	prim.LX = prim.LX & 0xfffe;
+	prim.HY = MAX3(prim.v[0].attr[0].y, prim.v[1].attr[0].y, prim.v[2].attr[0].y);
+	prim.HY = CLAMP(prim.HY, viewPortLY, viewPortLY+viewPortH-1);
+	prim.RX = MAX3(prim.v[0].attr[0].x, prim.v[1].attr[0].x, prim.v[2].attr[0].x);
+	prim.RX = CLAMP(prim.RX, viewPortLX, viewPortLX+viewPortW-1);
+
+	if (prim.RX - prim.LX < 4 && prim.HY - prim.LY < 4)
+		prim.sizeClass = TRI_SIZE_TINY;
+	else if (prim.RX - prim.LX < SPLIT_WIDTH && prim.HY - prim.LY < SPLIT_WIDTH)
+		prim.sizeClass = TRI_SIZE_SMALL;
+	else
+		prim.sizeClass = TRI_SIZE_LARGE;
+	prim.quadCover = 0;
+
+	// Lowest level whose tiles cover the boundary box with at most 2x2 of them
+	prim.splitLevel = START_SPLIT_LEVEL;
+	if (adaptiveSplitEnable) {
+		prim.splitLevel = 0;
+		while (prim.splitLevel < MAX_SPLIT_LEVEL &&
+			   ((prim.RX>>(prim.splitLevel+1)) - (prim.LX>>(prim.splitLevel+1)) > 1 ||
+				(prim.HY>>(prim.splitLevel+1)) - (prim.LY>>(prim.splitLevel+1)) > 1))
+			prim.splitLevel++;
+	}
+}
+
+void GPU_Core::AttribPlaneSetup()
+{
+	for (int i=0; i<MAX_ATTRIBUTE_NUMBER; i++) {
+		if (i != 0 && varyComp[i] == 0)
+			continue;
+
+		prim.planeA[i] = prim.v[1].attr[i] - prim.v[0].attr[i];
+		prim.planeB[i] = prim.v[2].attr[i] - prim.v[0].attr[i];
+	}
 }
 
 void GPU_Core::Culling()
@@ -345,11 +532,11 @@ void GPU_Core::Culling()
 	if (cullingEnable) {
 		switch (cullFaceMode) {
 		case GL_BACK:
-			if (area2Reciprocal > 0)
+			if (prim.area2Reciprocal > 0)
 				prim.iskilled = true;
 			break;
 		case GL_FRONT:
-			if (area2Reciprocal < 0)
+			if (prim.area2Reciprocal < 0)
 				prim.iskilled = true;
 			break;
 		case GL_FRONT_AND_BACK:
@@ -365,19 +552,51 @@ void GPU_Core::Culling()
 /*	Eliminate all (area < 0) condition to simplify the operation in tile split
  *	and interpolation.
  */
-	if (area2Reciprocal < 0) {
+	if (prim.area2Reciprocal < 0) {
 		std::swap(prim.v[1], prim.v[2]);
 
-		Edge[1][0] = -Edge[1][0];
-		Edge[1][1] = -Edge[1][1];
-		tmp1 = Edge[0][0];
-		tmp2 = Edge[0][1];
-		Edge[0][0] = -Edge[2][0];
-		Edge[0][1] = -Edge[2][1];
-		Edge[2][0] = -tmp1;
-		Edge[2][1] = -tmp2;
+		prim.Edge[1][0] = -prim.Edge[1][0];
+		prim.Edge[1][1] = -prim.Edge[1][1];
+		tmp1 = prim.Edge[0][0];
+		tmp2 = prim.Edge[0][1];
+		prim.Edge[0][0] = -prim.Edge[2][0];
+		prim.Edge[0][1] = -prim.Edge[2][1];
+		prim.Edge[2][0] = -tmp1;
+		prim.Edge[2][1] = -tmp2;
 
-		area2Reciprocal = -area2Reciprocal;
+		prim.area2Reciprocal = -prim.area2Reciprocal;
 	}
 }
 
+void GPU_Core::EdgeSetupFixed()
+{
+	int64_t X[3], Y[3];
+
+	for (int i=0; i<3; i++) {
+		X[i] = (int64_t)(prim.v[i].attr[0].x * (1<<SUBPIXEL_BITS));
+		Y[i] = (int64_t)(prim.v[i].attr[0].y * (1<<SUBPIXEL_BITS));
+	}
+
+/*	Edge i runs from v[i] to v[i+1] and is evaluated relative to v[i+1], the
+ *	same as the floating-point Edge[i].
+ */
+	for (int i=0; i<3; i++) {
+		int a = i, b = (i+1)%3;
+		int64_t e0 = Y[a] - Y[b], e1 = X[a] - X[b];
+
+		prim.EdgeFx[i][0] = e0;
+		prim.EdgeFx[i][1] = -e1;
+		prim.EdgeFx[i][2] = -X[b]*e0 + Y[b]*e1;
+
+		// Left edge: inside grows with x. Top edge: horizontal, inside below.
+		bool topLeft = (e0 > 0) || (e0 == 0 && e1 > 0);
+		prim.edgeBiasFx[i] = topLeft? 0 : 1;
+	}
+
+	int64_t doubleArea = (X[0]-X[1])*(Y[1]-Y[2]) - (Y[0]-Y[1])*(X[1]-X[2]);
+	if (doubleArea <= 0) {
+		prim.iskilled = true;
+		return;
+	}
+	prim.area2Reciprocal = 1.0f/(float)doubleArea;
+}
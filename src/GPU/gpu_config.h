@@ -38,13 +38,22 @@
  */
 #define START_SPLIT_LEVEL 3
 
+/**
+ *	@def MAX_SPLIT_LEVEL
+ *	Highest level tile split may start from when the start level is chosen per
+ *	triangle, 5 for 64*64. It must not be less than START_SPLIT_LEVEL, which
+ *	still sets the size of the screen tiles owned by each tile worker.
+ */
+#define MAX_SPLIT_LEVEL 5
+
 
 /// @name GPU internal resource configuration.
 ///@{
 /** @def MAX_SHADER_CORE
- *	This option cannot be defined less than 2 because 1 shader core for vertex
- *	shader and another one for fragment shader. Currently it has no effect if
- *	it is larger than 2 until the task scheduler is finished.
+ *	How many unified shader cores the GPU has. It must be at least 1. Vertex and
+ *	fragment batches are dispatched by the task scheduler to any idle shader
+ *	core, so more than 1 core is busy at the same time only when several tile
+ *	workers are running.
  */
 #define MAX_SHADER_CORE					2
 
@@ -56,6 +65,166 @@
  */
 #define SHADER_EXECUNIT					256
 
+/** @def DRAM_SIZE
+ *	Bytes of the simulated on-board DRAM, which holds the resident textures.
+ */
+#define DRAM_SIZE						0x4000000
+
+/** @def DEFAULT_TILE_WORKER
+ *	How many host threads run the fragment pipeline (tile split, fragment
+ *	shader and per-fragment operation) by default. Each tile worker owns a fixed
+ *	set of screen tiles and borrows an idle shader core for every fragment
+ *	batch. 1 means the whole fragment pipeline runs on the calling thread. It
+ *	can be changed at runtime by GPU_Core::SetTileWorker().
+ */
+#define DEFAULT_TILE_WORKER				1
+
+/** @def TILE_WORKER_BATCH
+ *	How many set-up triangles are collected before they are handed to the tile
+ *	workers. Larger batch means less synchronization between the geometry stage
+ *	and tile workers.
+ */
+#define TILE_WORKER_BATCH				256
+
+/** @def DEFAULT_DECOUPLED_PIPELINE
+ *	If it is 1, the geometry stage and the fragment stage run in different host
+ *	threads by default, and set-up triangles are passed through a bounded
+ *	primitive ring. It can be changed at runtime by
+ *	GPU_Core::decoupledPipeline.
+ */
+#define DEFAULT_DECOUPLED_PIPELINE		0
+
+/** @def PRIM_RING_SIZE
+ *	Capacity of the primitive ring between geometry and fragment stage. It must
+ *	be a power of 2. Geometry stage stalls when the ring is full.
+ */
+#define PRIM_RING_SIZE					1024
+
+/** @def VERTEX_CACHE_SIZE
+ *	Default entry count of the post-transform vertex cache which lets
+ *	DrawElements reuse a shaded vertex referenced again by the index buffer.
+ *	0 disables the cache. It can be changed at runtime by
+ *	GPU_Core::vtxCacheSize.
+ */
+#define VERTEX_CACHE_SIZE				32
+
+/** @def VERTEX_CACHE_POLICY
+ *	Default replacement policy of the post-transform vertex cache.
+ *	VTX_CACHE_FIFO behaves like the real hardware, VTX_CACHE_PERFECT keeps every
+ *	shaded vertex of a draw command and gives the upper bound of vertex reuse.
+ */
+#define VERTEX_CACHE_POLICY				VTX_CACHE_FIFO
+
+/** @def DEFAULT_EARLY_Z
+ *	If it is 1, the depth test is done before fragment shading when the
+ *	fragment program has no KIL and does not write depth, so occluded quads are
+ *	never shaded. Other programs keep the late depth test. It can be changed at
+ *	runtime by GPU_Core::earlyZEnable.
+ */
+#define DEFAULT_EARLY_Z					1
+
+/** @def DEFAULT_HIZ
+ *	If it is 1, tile split keeps the max depth of each 8x8 and 16x16 screen
+ *	tile, and skips a tile of START_SPLIT_LEVEL or below when the nearest depth
+ *	of the triangle is behind it.
+ *	It is only used with GL_LESS or GL_LEQUAL depth test, by a fragment program
+ *	which does not write depth and with START_SPLIT_LEVEL >= 2. It can be
+ *	changed at runtime by GPU_Core::hiZEnable.
+ */
+#define DEFAULT_HIZ						1
+
+/** @def DEFAULT_RASTERIZER
+ *	Rasterizer backend. RASTERIZER_RECURSIVE splits a tile by recursion.
+ *	RASTERIZER_SCAN visits the same tile hierarchy breadth-first and tests the
+ *	tiles of a level with host SIMD instructions. Both emit the same quads. It
+ *	can be changed at runtime by GPU_Core::rasterizer.
+ */
+#define DEFAULT_RASTERIZER				RASTERIZER_RECURSIVE
+
+/** @def DEFAULT_GUARD_BAND
+ *	Size of the guard band, in multiples of the viewport. Every triangle is
+ *	clipped against the near and far planes, but only a triangle with a vertex
+ *	outside the guard band is clipped against the left, right, bottom and top
+ *	planes. The rest is left to the rasterizer, which never leaves the
+ *	viewport. It must be at least 1, and small enough to keep the fixed-point
+ *	screen coordinates in range. It can be changed at runtime by
+ *	GPU_Core::guardBand.
+ */
+#define DEFAULT_GUARD_BAND				8.0f
+
+/** @def DEFAULT_FIXED_POINT_RASTER
+ *	If it is 1, vertices are snapped to a 16.8 fixed-point grid in the
+ *	viewport transform, and tile split evaluates edge functions in 64-bit
+ *	integers with the top-left fill rule. Pixels on an edge shared by two
+ *	triangles are then drawn exactly once. It can be changed at runtime by
+ *	GPU_Core::fixedPointRaster.
+ */
+#define DEFAULT_FIXED_POINT_RASTER		0
+
+/** @def SUBPIXEL_BITS
+ *	Fraction bits of the fixed-point screen coordinate.
+ */
+#define SUBPIXEL_BITS					8
+
+/** @def DEFAULT_SMALL_TRIANGLE
+ *	If it is 1, a triangle whose boundary box touches at most 2x2 quads skips
+ *	tile split. Its quads are tested once at triangle setup, where it is
+ *	dropped if it covers no pixel center, and the covered quads are emitted
+ *	directly. It can be changed at runtime by GPU_Core::smallTriangleEnable.
+ */
+#define DEFAULT_SMALL_TRIANGLE			1
+
+/** @def DEFAULT_ADAPTIVE_SPLIT
+ *	If it is 1, tile split of each triangle starts from the lowest level at
+ *	which its boundary box touches at most 2x2 tiles, up to MAX_SPLIT_LEVEL.
+ *	Otherwise it always starts from START_SPLIT_LEVEL. It can be changed at
+ *	runtime by GPU_Core::adaptiveSplitEnable.
+ */
+#define DEFAULT_ADAPTIVE_SPLIT			1
+
+/** @def DEFAULT_QUAD_MERGE
+ *	If it is 1, a partially covered quad is merged into the ghost pixels of a
+ *	quad waiting at the same position in the fragment accumulator, when every
+ *	pixel of both quads feeds the fragment program the same inputs, as on two
+ *	triangles of a flat face with continuous varyings. DDX/DDY and texture LOD
+ *	are then unchanged, so the output neither differs from the unmerged one
+ *	nor depends on when the accumulator is flushed. Only the number of merged
+ *	quads varies with the tile worker count. It can be changed at runtime by
+ *	GPU_Core::quadMergeEnable.
+ */
+#define DEFAULT_QUAD_MERGE				0
+
+/** @def DEFAULT_HELPER_LANE_MASK
+ *	If it is 1, ghost pixels and pixels killed by KIL become helper lanes. A
+ *	helper lane only runs the instructions whose results feed DDX/DDY or the
+ *	texture scale factor of its quad, found at link time. A quad without any
+ *	live pixel runs nothing but flow control. The output does not change. It
+ *	can be changed at runtime by GPU_Core::helperLaneMaskEnable.
+ */
+#define DEFAULT_HELPER_LANE_MASK		1
+
+/** @def DEFAULT_SHADER_ENGINE
+ *	Which execution engine the shader cores use by default.
+ *	SHADER_ENGINE_AOS interprets every instruction lane by lane.
+ *	SHADER_ENGINE_SOA keeps registers as per-component lane arrays and executes
+ *	ALU instructions across several lanes at once (4 lanes with SSE, 8 with AVX
+ *	and 16 with AVX-512, chosen by the compiler's target flags).
+ *	SHADER_ENGINE_JIT runs the SoA engine, but the program is replaced by
+ *	x86-64 code compiled at glLinkProgram time, flow control included. It
+ *	falls back to SHADER_ENGINE_SOA on other hosts.
+ *	All engines give the same result as long as the compiler does not fuse
+ *	multiply-add (add -ffp-contract=off when the target has FMA). It can be
+ *	changed at runtime by GPU_Core::shaderEngine.
+ */
+#define DEFAULT_SHADER_ENGINE			SHADER_ENGINE_SOA
+
+/** @def SHADER_JIT_MAX_NEST
+ *	How deep IF and REP blocks may nest in the native code of
+ *	SHADER_ENGINE_JIT. Each level keeps a condition stack entry or a loop
+ *	counter in the SoA register file. Deeper blocks are interpreted.
+ */
+#define SHADER_JIT_MAX_NEST				8
+
 #define MAX_ATTRIBUTE_NUMBER    		8
 #define MAX_VERTEX_UNIFORM_VECTORS		128
 #define MAX_FRAGMENT_UNIFORM_VECTORS	16
@@ -148,7 +317,43 @@
 #define TEXEL_INFO_FILE "texel_info"
 ///@}
 
+/**
+ *	@def SHADER_CACHE_DIR
+ *	Directory of the compiled shader cache. glCompileShader() looks up the NVGP4
+ *	assembly there by the hash of the GLSL source and the cgc options, and only
+ *	runs cgc on a miss. The files only depend on the source, so a populated
+ *	directory can be shared between runs and machines, including those
+ *	without cgc. An empty string disables the cache.
+ */
+#define SHADER_CACHE_DIR "shader_cache"
+
 /*************** !!! DO NOT TOUCH STUFF BELOW !!! *****************/
+#define VTX_CACHE_FIFO		0
+#define VTX_CACHE_PERFECT	1
+
+#define SHADER_ENGINE_AOS	0
+#define SHADER_ENGINE_SOA	1
+#define SHADER_ENGINE_JIT	2
+
+#define RASTERIZER_RECURSIVE	0
+#define RASTERIZER_SCAN			1
+
+#define TRI_SIZE_TINY		0 ///< Boundary box within 2x2 quads
+#define TRI_SIZE_SMALL		1 ///< Boundary box within one start tile size
+#define TRI_SIZE_LARGE		2
+
+#define CLIP_NEAR			0x01
+#define CLIP_FAR			0x02
+#define CLIP_LEFT			0x04
+#define CLIP_RIGHT			0x08
+#define CLIP_BOTTOM			0x10
+#define CLIP_TOP			0x20
+#define CLIP_VERTEX_MAX		9 ///< A triangle clipped by all six planes
+
+#define LANE_LIVE			0 ///< Pixel whose result is used
+#define LANE_HELPER			1 ///< Only feeds derivatives of live lanes in its quad
+#define LANE_IDLE			2 ///< Nothing in its quad is live
+
 #ifdef DEBUG
 #	define DBG_ON 1
 #else
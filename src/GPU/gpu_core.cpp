@@ -25,6 +25,31 @@
 
 GPU_Core gpu;
 
+/// Bounding box area bucket names of the rasterizer benchmark
+static const char *rasterBucketName[4] = {
+	"<=8x8", "<=32x32", "<=128x128", ">128x128"
+};
+
+/// Does the fragment program discard fragments?
+static bool HasKill(const instruction *inst, int instCnt)
+{
+	for (int i=0; i<instCnt; i++) {
+		if (inst[i].op == OP_KIL)
+			return true;
+	}
+	return false;
+}
+
+/// Does the fragment program replace the depth of its fragments?
+static bool WritesDepth(const decodedInst *dec, int instCnt)
+{
+	for (int i=0; i<instCnt; i++) {
+		if (dec[i].dstType == INST_ATTRIB && dec[i].dstID == 0)
+			return true;
+	}
+	return false;
+}
+
 void GPU_Core::Run()
 {
     //clear frame buffer if needed
@@ -36,82 +61,197 @@ void GPU_Core::Run()
 
 	PassConfig2SubModule();
 
+	// The decoded programs of the previous draw are kept while they are valid.
+	if (programDirty) {
+		VSdecPool.resize(VSinstCnt);
+		DecodeProgram(VSinstPool, VSinstCnt, uniformPool, VSdecPool.data());
+		FSdecPool.resize(FSinstCnt);
+		DecodeProgram(FSinstPool, FSinstCnt, uniformPool, FSdecPool.data());
+		if (FSrunLane != nullptr) {
+			for (int i=0; i<FSinstCnt; i++)
+				FSdecPool[i].runLane = FSrunLane[i];
+		}
+		programDirty = false;
+	}
+	if (shaderEngine == SHADER_ENGINE_JIT) {
+		if (VSjit != nullptr) {
+			VSjitConst.resize(VSjit->ConstSize());
+			VSjit->FillConstant(VSdecPool.data(), VSjitConst.data());
+		}
+		if (FSjit != nullptr) {
+			FSjitConst.resize(FSjit->ConstSize());
+			FSjit->FillConstant(FSdecPool.data(), FSjitConst.data());
+		}
+	}
+
+	/* Early-Z gives the same result as the late depth test only if the
+	 * fragment program neither discards fragments nor replaces their depth.
+	 * Hierarchical Z only needs the latter, since it drops whole quads which
+	 * would fail anyway.
+	 */
+	bool depthWrite = WritesDepth(FSdecPool.data(), FSinstCnt);
+	earlyZ = earlyZEnable && depthTestEnable && !depthWrite &&
+			 !HasKill(FSinstPool, FSinstCnt);
+	hiZ = hiZEnable && depthTestEnable && !depthWrite &&
+		  (depthTestMode == GL_LESS || depthTestMode == GL_LEQUAL) &&
+		  START_SPLIT_LEVEL >= 2;
+	if (hiZ)
+		BuildHiZ();
+
+	/* Only the components the fragment program reads are interpolated. A
+	 * normalized varying needs xyz for its length whatever is read.
+	 */
+	int varyCompCnt = 0, varyEnableCnt = 0;
+	varyComp[0] = 0;
+	for (int i=1; i<MAX_ATTRIBUTE_NUMBER; i++) {
+		varyComp[i] = varyEnable[i]? (varyRead >> (4*i)) & 0xf : 0;
+		if (varyComp[i] != 0 && bool(varyInterpMode[i] & INTERP_NORMALIZE))
+			varyComp[i] |= 0x7;
+		for (int c=0; c<4; c++)
+			varyCompCnt += (varyComp[i] >> c) & 1;
+		varyEnableCnt += varyEnable[i]? 4 : 0;
+	}
+
 	InitPrimitiveAssembly();
+	ClearVertexCache();
 	//Clear texture cache when new draw command is arrived.
 	///@todo Judge if cleaning texture cache is required.
 	for (int i=0; i<MAX_SHADER_CORE; i++)
-		sCore[i].texUnit.ClearTexCache();
-
-    //Main loop
-    for (int vCnt=0; vCnt<vtxCount; vCnt++) {
+		sCore[i]->texUnit.ClearStat();
+	vsTexCache->Clear();
+	for (int i=0; i<tileWorkerCnt; i++)
+		tWorker[i]->texCache->Clear();
+
+	if (decoupledPipeline) {
+		geometryDone = false;
+		fragmentThread = std::thread(&GPU_Core::FragmentStageLoop, this);
+	}
 
-		FetchVertexData(vCnt);
+	//Main loop
+	for (int vBase=0; vBase<vtxCount; vBase+=SHADER_EXECUNIT) {
+		int batchCnt = std::min(SHADER_EXECUNIT, vtxCount - vBase);
 
 		//Vertex-based operation starts here
 		///@todo Task scheduler for auto job dispatch
-        VertexShaderEXE(0, &curVtx);
-
-        PrimitiveAssembly();
-
-        //Primitive-based operation starts here
-        while (!primFIFO.empty()) {
-			prim = primFIFO.front();
-
-			if (prim.isGenerated == false) {
-				Clipping();
-
-				if (prim.iskilled) {
-					primFIFO.pop();
-					continue;
-				}
-			}
-
-			PerspectiveDivision(&prim.v[0]);
-			PerspectiveDivision(&prim.v[1]);
-			PerspectiveDivision(&prim.v[2]);
-			ViewPort(&prim.v[0]);
-			ViewPort(&prim.v[1]);
-			ViewPort(&prim.v[2]);
+		ShadeVertexBatch(vBase, batchCnt);
 
-            TriangleSetup();
-            Culling();
+		for (int vCnt=0; vCnt<batchCnt; vCnt++) {
+			curVtx = vtxBatch[vCnt];
 
-            if (prim.iskilled) {
-				totalCulledPrimitive++;
-				primFIFO.pop();
+			//Primitive-based operation starts here
+			if (!PrimitiveAssembly())
 				continue;
-            }
 
-            //Fragment-based operation starts here
-			for(int y=LY; y<=HY; y+=SPLIT_WIDTH) {
-				for(int x=LX; x<=RX; x+=SPLIT_WIDTH) {
-					PIXPRINTF("Recursive Entry:-------(%d,%d)-----\n",x,y);
-					pixBufferP = 0;
-
-					tileSplit(x,y,START_SPLIT_LEVEL);
-
-					int processedCount=0;
-					while (processedCount < pixBufferP) {
-						FragmentShaderEXE(1, processedCount);
-					}
-
-					for (int i=0; i<pixBufferP; i++)
-						PerFragmentOp(pixBuffer[i]);
-				}
+			int clipCnt = Clipping();
+			for (int c=0; c<clipCnt; c++) {
+				prim = clipPrim[c];
+				SetupAndEmit();
 			}
+		}
+	}
 
-			primFIFO.pop();
-        }
-    }
+	if (decoupledPipeline) {
+		geometryDone.store(true, std::memory_order_release);
+		fragmentThread.join();
+	}
+	else
+		FlushTriangleBatch();
+
+	for (int i=0; i<tileWorkerCnt; i++) {
+		tileWorker *tw = tWorker[i];
+
+		totalProcessingPix += tw->totalProcessingPix;
+		totalGhostPix += tw->totalGhostPix;
+		totalLivePix += tw->totalLivePix;
+		earlyZRejectPix += tw->earlyZRejectPix;
+		mergedQuadCnt += tw->mergedQuadCnt;
+		for (int l=0; l<=MAX_SPLIT_LEVEL; l++) {
+			tileSplitCnt += tw->tileSplitCnt[l];
+			tileSplitLevelCnt[l] += tw->tileSplitCnt[l];
+			hiZRejectTile[l] += tw->hiZRejectTile[l];
+			hiZRejectPix[l] += tw->hiZRejectPix[l];
+			trivialAcceptTile[l] += tw->trivialAcceptTile[l];
+			tw->tileSplitCnt[l] = 0;
+			tw->hiZRejectTile[l] = tw->hiZRejectPix[l] = 0;
+			tw->trivialAcceptTile[l] = 0;
+		}
+		for (int b=0; b<4; b++) {
+			rasterTriCnt[b] += tw->rasterTriCnt[b];
+			rasterNs[b] += tw->rasterNs[b];
+			tw->rasterTriCnt[b] = 0;
+			tw->rasterNs[b] = 0;
+		}
+		fsInstructionCnt += tw->fsInstructionCnt;
+		fsScaleOperation += tw->fsScaleOperation;
+		fsHelperInstructionCnt += tw->fsHelperInstructionCnt;
+		fsHelperSkipCnt += tw->fsHelperSkipCnt;
+		fsDispatchCnt += tw->fsDispatchCnt;
+		fsLaneUsed += tw->fsLaneUsed;
+		tw->totalProcessingPix = tw->totalGhostPix = tw->totalLivePix = 0;
+		tw->earlyZRejectPix = tw->mergedQuadCnt = 0;
+		tw->fsInstructionCnt = tw->fsScaleOperation = 0;
+		tw->fsHelperInstructionCnt = tw->fsHelperSkipCnt = 0;
+		tw->fsDispatchCnt = tw->fsLaneUsed = 0;
+		dram.accessB += tw->texCache->dram.accessB;
+		dram.accessTime += tw->texCache->dram.accessTime;
+		tw->texCache->dram.accessB = 0;
+		tw->texCache->dram.accessTime = 0;
+	}
+	dram.accessB += vsTexCache->dram.accessB;
+	dram.accessTime += vsTexCache->dram.accessTime;
+	vsTexCache->dram.accessB = 0;
+	vsTexCache->dram.accessTime = 0;
+
+	int texHit = 0, texMiss = 0;
+	for (int i=0; i<MAX_SHADER_CORE; i++) {
+		texHit += sCore[i]->texUnit.hit;
+		texMiss += sCore[i]->texUnit.miss;
+	}
 
     GPUPRINTF("Total processed vertex: %d\n",totalProcessingVtx);
+	GPUPRINTF("Vertex cache hit: %d\n",vtxCacheHit);
+	GPUPRINTF("Vertex cache miss: %d\n",vtxCacheMiss);
+	GPUPRINTF("Vertex cache hit rate: %f\n",
+			  (vtxCacheHit + vtxCacheMiss) == 0 ? 0.0 :
+			  (float)vtxCacheHit / (vtxCacheHit + vtxCacheMiss) );
     GPUPRINTF("Total processed Primitive: %d\n",totalProcessingPrimitive);
     GPUPRINTF("Total added primitives from clipping: %d\n",totalGeneratedPrimitive);
     GPUPRINTF("Total clipped primitives: %d\n",totalClippedPrimitive);
+	GPUPRINTF("Clipped at the guard band (%.1fx viewport): %d\n",
+			  guardBand, guardBandClipCnt);
     GPUPRINTF("Total culled Primitive(Include completely outside the clip volume): %d\n",totalCulledPrimitive);
     GPUPRINTF("Tile Split Count: %d\n",tileSplitCnt);
     GPUPRINTF("Total processed pixel: %d\n",totalProcessingPix);
 	GPUPRINTF("Ghost pixel: %d\n",totalGhostPix);
+	GPUPRINTF("Depth test: %s\n", earlyZ ? "early-Z" : "late-Z");
+	GPUPRINTF("Early-Z rejected pixel: %d\n",earlyZRejectPix);
+	GPUPRINTF("Hierarchical Z: %s\n", hiZ ? "on" : "off");
+	for (int l=MAX_SPLIT_LEVEL; l>=0; l--)
+		GPUPRINTF("HiZ rejected at %dx%d: tile %d, pixel %d\n",
+				  2<<l, 2<<l, hiZRejectTile[l], hiZRejectPix[l]);
+	for (int l=START_SPLIT_LEVEL; l>0; l--)
+		GPUPRINTF("Trivially accepted %dx%d tile: %d\n",
+				  2<<l, 2<<l, trivialAcceptTile[l]);
+	GPUPRINTF("Start split level: %s\n", adaptiveSplitEnable ? "adaptive" : "fixed");
+	for (int l=MAX_SPLIT_LEVEL; l>=0; l--)
+		GPUPRINTF("Split level %dx%d: start %d triangle, split %d tile\n",
+				  2<<l, 2<<l, splitLevelCnt[l], tileSplitLevelCnt[l]);
+	GPUPRINTF("Triangle size: tiny %d, small %d, large %d\n",
+			  triSizeCnt[TRI_SIZE_TINY], triSizeCnt[TRI_SIZE_SMALL],
+			  triSizeCnt[TRI_SIZE_LARGE]);
+	GPUPRINTF("Tiny triangle fast path: %s, %d dropped without covered pixel\n",
+			  smallTriangleEnable ? "on" : "off", emptyTriangleCnt);
+	GPUPRINTF("Rasterizer: %s%s\n",
+			  rasterizer == RASTERIZER_SCAN ? "scan" : "recursive",
+			  fixedPointRaster ? ", 16.8 fixed point" : "");
+	for (int b=0; b<4; b++)
+		GPUPRINTF("Rasterize %s triangle: %d, %.3f ms, %.1f ns per triangle\n",
+				  rasterBucketName[b], rasterTriCnt[b], rasterNs[b]/1e6,
+				  rasterTriCnt[b] == 0 ? 0.0 : (double)rasterNs[b]/rasterTriCnt[b]);
+	GPUPRINTF("Quad merge: %s, %d quads merged\n",
+			  quadMergeEnable ? "on" : "off", mergedQuadCnt);
+	GPUPRINTF("Interpolated varying: %d of %d enabled components\n",
+			  varyCompCnt, varyEnableCnt);
 	GPUPRINTF("Normal/All processed pixel ratio: %f\n",
 			  (float)(totalProcessingPix - totalGhostPix)/totalProcessingPix);
 	GPUPRINTF("Final living pixel: %d\n\n",totalLivePix);
@@ -119,39 +259,121 @@ void GPU_Core::Run()
 	GPUPRINTF("Texture memory access: %.2f MB (%llu)\n",
 			  (float)dram.accessB/1024/1024,
 			  dram.accessB);
-	GPUPRINTF("Texture memory access time: %.2f ms (%.2f ns)\n\n",
+	GPUPRINTF("Texture memory access time: %.2f ms (%.2f ns)\n",
 			  dram.accessTime/1000/1000,
 			  dram.accessTime);
-
-    GPUPRINTF("Texture cache hit: %d\n",sCore[1].texUnit.hit);
-    GPUPRINTF("Texture cache miss: %d\n",sCore[1].texUnit.miss);
+	DRAMAllocator::stat memStat = dramAlloc.Stat();
+	GPUPRINTF("Device memory: live %u KB in %d blocks, peak %u KB, "
+			  "fragmentation %.2f, failed allocation %d\n\n",
+			  memStat.liveByte/1024, memStat.liveBlock, memStat.peakByte/1024,
+			  memStat.Fragmentation(), memStat.failCnt);
+
+    GPUPRINTF("Texture cache hit: %d\n",texHit);
+    GPUPRINTF("Texture cache miss: %d\n",texMiss);
     GPUPRINTF("Texture cache miss rate: %f\n\n",
-			   (float)sCore[1].texUnit.miss /
-			   (sCore[1].texUnit.hit + sCore[1].texUnit.miss) );
+			   (float)texMiss / (texHit + texMiss) );
 
-	GPUPRINTF("VShader total executed instruction: %d\n",
-			   sCore[0].totalInstructionCnt);
-	GPUPRINTF("VShader total executed scale operation: %d\n",
-			   sCore[0].totalScaleOperation);
+	GPUPRINTF("VShader total executed instruction: %d\n", vsInstructionCnt);
+	GPUPRINTF("VShader total executed scale operation: %d\n", vsScaleOperation);
 	GPUPRINTF("Vertex Shader Usage: %f\n\n",
-			   (float)(sCore[0].totalScaleOperation)/(sCore[0].totalInstructionCnt*4));
+			   (float)vsScaleOperation/(vsInstructionCnt*4));
 
-	GPUPRINTF("FShader total executed instruction: %d\n",
-			   sCore[1].totalInstructionCnt);
-	GPUPRINTF("FShader total executed scale operation: %d\n",
-			   sCore[1].totalScaleOperation);
+	GPUPRINTF("FShader total executed instruction: %d\n", fsInstructionCnt);
+	GPUPRINTF("FShader total executed scale operation: %d\n", fsScaleOperation);
 	GPUPRINTF("Fragment Shader Usage: %f\n",
-			   (float)(sCore[1].totalScaleOperation)/(sCore[1].totalInstructionCnt*4));
+			   (float)fsScaleOperation/(fsInstructionCnt*4));
+	GPUPRINTF("FShader lane instruction: live %d, helper %d, skipped %d (mask %s)\n",
+			  fsInstructionCnt - fsHelperInstructionCnt, fsHelperInstructionCnt,
+			  fsHelperSkipCnt, helperLaneMaskEnable ? "on" : "off");
+	GPUPRINTF("FShader dispatch: %d\n", fsDispatchCnt);
+	GPUPRINTF("FShader lane occupancy: %f\n\n",
+			   fsDispatchCnt == 0 ? 0.0 :
+			   (float)fsLaneUsed/((float)fsDispatchCnt*SHADER_EXECUNIT));
+
+	if (shaderEngine == SHADER_ENGINE_JIT && VSjit != nullptr && FSjit != nullptr)
+		GPUPRINTF("Shader engine: JIT, VS %d/%d FS %d/%d instructions native\n",
+				  VSjit->NativeInstCount(), VSjit->InstCount(),
+				  FSjit->NativeInstCount(), FSjit->InstCount());
+	else if (shaderEngine != SHADER_ENGINE_AOS)
+		GPUPRINTF("Shader engine: SoA, %d lanes per host instruction\n",
+				  SHADER_SOA_WIDTH);
+	else
+		GPUPRINTF("Shader engine: AoS\n");
+	for (int i=0; i<MAX_SHADER_CORE; i++) {
+		GPUPRINTF("Shader core %d: VS batch %d, FS batch %d, instruction %d, "
+				  "texture cache hit %d, miss %d\n",
+				  i,
+				  sCore[i]->vertexBatchCnt,
+				  sCore[i]->fragmentBatchCnt,
+				  sCore[i]->totalInstructionCnt,
+				  sCore[i]->texUnit.hit,
+				  sCore[i]->texUnit.miss );
+	}
+	GPUPRINTF("Tile worker: %d\n", tileWorkerCnt);
+
+	GPUPRINTF("Primitive ring average occupancy: %f\n",
+			  primRingPushCnt == 0 ? 0.0 :
+			  (double)primRingOccupancySum / primRingPushCnt);
+	GPUPRINTF("Primitive ring max occupancy: %d/%d\n",
+			  primRingMaxOccupancy, PRIM_RING_SIZE);
+	GPUPRINTF("Primitive ring full stall: %d\n", primRingStall);
+	GPUPRINTF("Primitive ring empty starve: %d\n", primRingStarve);
 	GPUPRINTF("==========================================================\n");
 
 }
 
-GPU_Core::GPU_Core() : sCore({&dram, &dram})
+void GPU_Core::SetupAndEmit()
+{
+	PerspectiveDivision(&prim.v[0]);
+	PerspectiveDivision(&prim.v[1]);
+	PerspectiveDivision(&prim.v[2]);
+	ViewPort(&prim.v[0]);
+	ViewPort(&prim.v[1]);
+	ViewPort(&prim.v[2]);
+
+	TriangleSetup();
+	Culling();
+	if (fixedPointRaster && !prim.iskilled)
+		EdgeSetupFixed();
+
+	if (prim.iskilled) {
+		totalCulledPrimitive++;
+		return;
+	}
+
+	triSizeCnt[prim.sizeClass]++;
+	if (smallTriangleEnable && prim.sizeClass == TRI_SIZE_TINY) {
+		QuadCoverSetup();
+		if (prim.quadCover == 0) {
+			emptyTriangleCnt++;
+			return;
+		}
+	}
+	if (prim.quadCover == 0)
+		splitLevelCnt[prim.splitLevel]++;
+
+	//Fragment-based operation starts here
+	AttribPlaneSetup();
+	EmitTriangle();
+}
+
+GPU_Core::GPU_Core()
 {
+	for (int i=0; i<MAX_SHADER_CORE; i++) {
+		sCore[i] = new ShaderCore(&dram);
+		coreBusy[i] = false;
+	}
+	vsTexCache = new textureCache(&dram);
+	coreTicketHead = coreTicketTail = 0;
+
 	for (int i=0; i<MAX_ATTRIBUTE_NUMBER; i++) {
 		attrEnable[i] = false;
 		varyEnable[i] = false;
 	}
+	varyRead = ~0u;
+	VSinstPool = FSinstPool = nullptr;
+	VSinstCnt = FSinstCnt = 0;
+	programDirty = true;
 
 	depthRangeN = 0.0;
 	depthRangeF = 1.0;
@@ -164,8 +386,60 @@ GPU_Core::GPU_Core() : sCore({&dram, &dram})
 
 	totalProcessingPrimitive = totalProcessingPix = totalProcessingVtx =
 		totalGhostPix = totalLivePix = totalCulledPrimitive =
-		totalGeneratedPrimitive = 0;
+		totalGeneratedPrimitive = totalClippedPrimitive = guardBandClipCnt = 0;
 	tileSplitCnt = 0;
+	earlyZRejectPix = 0;
+	mergedQuadCnt = 0;
+	for (int l=0; l<=MAX_SPLIT_LEVEL; l++) {
+		tileSplitLevelCnt[l] = splitLevelCnt[l] = 0;
+		hiZRejectTile[l] = hiZRejectPix[l] = 0;
+		trivialAcceptTile[l] = 0;
+	}
+	for (int b=0; b<4; b++) {
+		rasterTriCnt[b] = 0;
+		rasterNs[b] = 0;
+	}
+	for (int c=0; c<3; c++)
+		triSizeCnt[c] = 0;
+	emptyTriangleCnt = 0;
+	vtxCacheHit = vtxCacheMiss = 0;
+	vsInstructionCnt = vsScaleOperation = 0;
+	fsInstructionCnt = fsScaleOperation = 0;
+	fsHelperInstructionCnt = fsHelperSkipCnt = 0;
+	fsDispatchCnt = fsLaneUsed = 0;
+	primRingStall = primRingStarve = primRingMaxOccupancy = 0;
+	primRingOccupancySum = 0;
+	primRingPushCnt = 0;
+
+	decoupledPipeline = DEFAULT_DECOUPLED_PIPELINE;
+	primRing.resize(PRIM_RING_SIZE);
+	primRingHead = primRingTail = 0;
+	geometryDone = false;
+
+	vtxCacheSize = VERTEX_CACHE_SIZE;
+	vtxCachePolicy = VERTEX_CACHE_POLICY;
+	shaderEngine = DEFAULT_SHADER_ENGINE;
+	earlyZEnable = DEFAULT_EARLY_Z;
+	earlyZ = false;
+	hiZEnable = DEFAULT_HIZ;
+	rasterizer = DEFAULT_RASTERIZER;
+	guardBand = DEFAULT_GUARD_BAND;
+	fixedPointRaster = DEFAULT_FIXED_POINT_RASTER;
+	smallTriangleEnable = DEFAULT_SMALL_TRIANGLE;
+	adaptiveSplitEnable = DEFAULT_ADAPTIVE_SPLIT;
+	quadMergeEnable = DEFAULT_QUAD_MERGE;
+	helperLaneMaskEnable = DEFAULT_HELPER_LANE_MASK;
+	hiZ = false;
+	VSjit = FSjit = nullptr;
+	FSrunLane = nullptr;
+	vtxCacheHead = 0;
+
+	tileWorkerCnt = 0;
+	workerJobID = 0;
+	workerBusyCnt = 0;
+	workerExit = false;
+	triBatch.reserve(TILE_WORKER_BATCH);
+	SetTileWorker(DEFAULT_TILE_WORKER);
 
 #if defined(DEBUG) && defined(GPU_INFO) && defined(GPU_INFO_FILE)
 	GPUINFOfp = fopen((std::string(GPU_INFO_FILE)+".txt").c_str(),"w");
@@ -177,6 +451,8 @@ GPU_Core::GPU_Core() : sCore({&dram, &dram})
 
 GPU_Core::~GPU_Core()
 {
+	SetTileWorker(0);
+
 #if defined(DEBUG) && defined(GPU_INFO) && defined(GPU_INFO_FILE)
 	fclose(GPUINFOfp);
 #endif // GPU_INFO && GPU_INFO_FILE
@@ -186,16 +462,19 @@ GPU_Core::~GPU_Core()
 
 #if defined(DEBUG) && defined(TEXEL_INFO) && defined(TEXEL_INFO_FILE)
 	for (int i=0; i<MAX_SHADER_CORE; i++) {
-		fclose(sCore[i].texUnit.TEXELINFOfp);
+		fclose(sCore[i]->texUnit.TEXELINFOfp);
 	}
 #endif //TEXEL_INFO && TEXEL_INFO_FILE
+
+	for (int i=0; i<MAX_SHADER_CORE; i++)
+		delete sCore[i];
+	delete vsTexCache;
 }
 
-void GPU_Core::FetchVertexData(uint32_t vCnt)
+uint32_t GPU_Core::GetVertexIndex(uint32_t vCnt)
 {
-	uint32_t vIdx;
+	uint32_t vIdx = 0;
 
-	//Get vertex index
 	if (vtxInputMode == 0) //drawArray
 		vIdx = vtxFirst + vCnt;
 	else { //drawElements
@@ -212,51 +491,256 @@ void GPU_Core::FetchVertexData(uint32_t vCnt)
 		}
 	}
 
+	return vIdx;
+}
+
+void GPU_Core::FetchVertexData(uint32_t vIdx, vertex *vtx)
+{
 	//Fetch all data from a index-determined vertex
 	for (int attrCnt=0; attrCnt<MAX_ATTRIBUTE_NUMBER; attrCnt++) {
 		if (attrEnable[attrCnt]) {
-			curVtx.attr[attrCnt].x =
+			vtx->attr[attrCnt].x =
 				*( (float*)vtxPointer[attrCnt] + attrSize[attrCnt]*vIdx );
-			curVtx.attr[attrCnt].y =
+			vtx->attr[attrCnt].y =
 				*( (float*)vtxPointer[attrCnt] + attrSize[attrCnt]*vIdx + 1 );
 			if (attrSize[attrCnt] > 2)
-				curVtx.attr[attrCnt].z =
+				vtx->attr[attrCnt].z =
 					*( (float*)vtxPointer[attrCnt] + attrSize[attrCnt]*vIdx + 2 );
 			else
-				curVtx.attr[attrCnt].z = 0.0;
+				vtx->attr[attrCnt].z = 0.0;
 
 			if (attrSize[attrCnt] > 3)
-				curVtx.attr[attrCnt].w =
+				vtx->attr[attrCnt].w =
 					*( (float*)vtxPointer[attrCnt] + attrSize[attrCnt]*vIdx + 3 );
 			else
-				curVtx.attr[attrCnt].w = 1.0;
+				vtx->attr[attrCnt].w = 1.0;
 		}
 	}
 
-	curVtx.threadId = totalProcessingVtx++;
+	vtx->threadId = totalProcessingVtx++;
 }
 
 void GPU_Core::PassConfig2SubModule()
 {
 	int i,j;
+
 	for (j=0; j<MAX_SHADER_CORE; j++) {
+		sCore[j]->engine = shaderEngine;
+
 		for (i=0; i<MAX_TEXTURE_CONTEXT; i++) {
-			sCore[j].texUnit.minFilter[i] = minFilter[i];
-			sCore[j].texUnit.magFilter[i] = magFilter[i];
-			sCore[j].texUnit.wrapS[i] = wrapS[i];
-			sCore[j].texUnit.wrapT[i] = wrapT[i];
-			sCore[j].texUnit.maxAnisoFilterRatio = maxAnisoFilterRatio;
-			sCore[j].texUnit.tex2D[i] = tex2D[i];
-			sCore[j].texUnit.texCubeNX[i] = texCubeNX[i];
-			sCore[j].texUnit.texCubeNY[i] = texCubeNY[i];
-			sCore[j].texUnit.texCubeNZ[i] = texCubeNZ[i];
-			sCore[j].texUnit.texCubePX[i] = texCubePX[i];
-			sCore[j].texUnit.texCubePY[i] = texCubePY[i];
-			sCore[j].texUnit.texCubePZ[i] = texCubePZ[i];
+			sCore[j]->texUnit.minFilter[i] = minFilter[i];
+			sCore[j]->texUnit.magFilter[i] = magFilter[i];
+			sCore[j]->texUnit.wrapS[i] = wrapS[i];
+			sCore[j]->texUnit.wrapT[i] = wrapT[i];
+			sCore[j]->texUnit.maxAnisoFilterRatio = maxAnisoFilterRatio;
+			sCore[j]->texUnit.tex2D[i] = tex2D[i];
+			sCore[j]->texUnit.texCubeNX[i] = texCubeNX[i];
+			sCore[j]->texUnit.texCubeNY[i] = texCubeNY[i];
+			sCore[j]->texUnit.texCubeNZ[i] = texCubeNZ[i];
+			sCore[j]->texUnit.texCubePX[i] = texCubePX[i];
+			sCore[j]->texUnit.texCubePY[i] = texCubePY[i];
+			sCore[j]->texUnit.texCubePZ[i] = texCubePZ[i];
 		}
 #if defined(DEBUG) && defined(TEXEL_INFO) && defined(TEXEL_INFO_FILE)
-		sCore[j].texUnit.TEXELINFOfp =
+		sCore[j]->texUnit.TEXELINFOfp =
 			fopen((std::string(TEXEL_INFO_FILE)+'_'+std::to_string(j)+".txt").c_str(),"w");
 #endif //TEXEL_INFO && TEXEL_INFO_FILE
 	}
 }
+
+void GPU_Core::SetTileWorker(int workerCnt)
+{
+	StopTileWorker();
+
+	for (int i=0; i<(int)tWorker.size(); i++) {
+		delete tWorker[i]->texCache;
+		delete tWorker[i];
+	}
+	tWorker.clear();
+
+	tileWorkerCnt = workerCnt;
+	if (workerCnt <= 0)
+		return;
+
+	for (int i=0; i<workerCnt; i++) {
+		tileWorker *tw = new tileWorker;
+
+		tw->id = i;
+		tw->tri = nullptr;
+		tw->texCache = new textureCache(&dram);
+		tw->pixBufferP = 0;
+		tw->totalProcessingPix = tw->totalGhostPix = tw->totalLivePix = 0;
+		tw->earlyZRejectPix = tw->mergedQuadCnt = 0;
+		tw->fsInstructionCnt = tw->fsScaleOperation = 0;
+		tw->fsHelperInstructionCnt = tw->fsHelperSkipCnt = 0;
+		tw->fsDispatchCnt = tw->fsLaneUsed = 0;
+		tw->pixBatchTag = 1;
+		for (int l=0; l<=MAX_SPLIT_LEVEL; l++) {
+			tw->tileSplitCnt[l] = 0;
+			tw->hiZRejectTile[l] = tw->hiZRejectPix[l] = 0;
+			tw->trivialAcceptTile[l] = 0;
+		}
+		for (int b=0; b<4; b++) {
+			tw->rasterTriCnt[b] = 0;
+			tw->rasterNs[b] = 0;
+		}
+		tw->flushNs = 0;
+		tWorker.push_back(tw);
+	}
+
+	workerExit = false;
+	for (int i=1; i<workerCnt; i++)
+		workerThread.push_back(
+			std::thread(&GPU_Core::TileWorkerLoop, this, i, workerJobID) );
+}
+
+void GPU_Core::StopTileWorker()
+{
+	{
+		std::lock_guard<std::mutex> lock(workerMutex);
+		workerExit = true;
+	}
+	workerStartCV.notify_all();
+
+	for (int i=0; i<(int)workerThread.size(); i++)
+		workerThread[i].join();
+	workerThread.clear();
+}
+
+void GPU_Core::TileWorkerLoop(int wid, int lastJobID)
+{
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(workerMutex);
+			workerStartCV.wait(lock, [&] {
+				return workerExit || workerJobID != lastJobID;
+			});
+			if (workerExit)
+				return;
+			lastJobID = workerJobID;
+		}
+
+		RasterizeBatch(wid);
+
+		{
+			std::lock_guard<std::mutex> lock(workerMutex);
+			if (--workerBusyCnt == 0)
+				workerDoneCV.notify_one();
+		}
+	}
+}
+
+void GPU_Core::FlushTriangleBatch()
+{
+	if (triBatch.empty())
+		return;
+
+	if (tileWorkerCnt > 1) {
+		{
+			std::lock_guard<std::mutex> lock(workerMutex);
+			workerBusyCnt = tileWorkerCnt - 1;
+			workerJobID++;
+		}
+		workerStartCV.notify_all();
+	}
+
+	//The calling thread always works as tile worker 0.
+	RasterizeBatch(0);
+
+	if (tileWorkerCnt > 1) {
+		std::unique_lock<std::mutex> lock(workerMutex);
+		workerDoneCV.wait(lock, [&] { return workerBusyCnt == 0; });
+	}
+
+	triBatch.clear();
+}
+
+int GPU_Core::AcquireShaderCore()
+{
+	int cid = 0;
+	std::unique_lock<std::mutex> lock(coreMutex);
+	unsigned int ticket = coreTicketTail++;
+
+	coreIdleCV.wait(lock, [&] {
+		if (ticket != coreTicketHead)
+			return false;
+		for (cid=0; cid<MAX_SHADER_CORE; cid++) {
+			if (!coreBusy[cid])
+				return true;
+		}
+		return false;
+	});
+
+	coreBusy[cid] = true;
+	coreTicketHead++;
+	lock.unlock();
+	coreIdleCV.notify_all();
+
+	return cid;
+}
+
+void GPU_Core::ReleaseShaderCore(int cid)
+{
+	{
+		std::lock_guard<std::mutex> lock(coreMutex);
+		coreBusy[cid] = false;
+	}
+	coreIdleCV.notify_all();
+}
+
+void GPU_Core::EmitTriangle()
+{
+	if (!decoupledPipeline) {
+		triBatch.push_back(prim);
+		if (triBatch.size() >= TILE_WORKER_BATCH)
+			FlushTriangleBatch();
+		return;
+	}
+
+	unsigned int tail = primRingTail.load(std::memory_order_relaxed);
+
+	if (tail - primRingHead.load(std::memory_order_acquire) >= PRIM_RING_SIZE) {
+		primRingStall++;
+		while (tail - primRingHead.load(std::memory_order_acquire) >= PRIM_RING_SIZE)
+			std::this_thread::yield();
+	}
+
+	primRing[tail & (PRIM_RING_SIZE-1)] = prim;
+	primRingTail.store(tail + 1, std::memory_order_release);
+
+	int occupancy = tail + 1 - primRingHead.load(std::memory_order_relaxed);
+	primRingOccupancySum += occupancy;
+	primRingMaxOccupancy = std::max(primRingMaxOccupancy, occupancy);
+	primRingPushCnt++;
+}
+
+void GPU_Core::FragmentStageLoop()
+{
+	bool starving = false;
+
+	while (true) {
+		unsigned int head = primRingHead.load(std::memory_order_relaxed);
+		unsigned int tail = primRingTail.load(std::memory_order_acquire);
+
+		if (head == tail) {
+			if (geometryDone.load(std::memory_order_acquire) &&
+				head == primRingTail.load(std::memory_order_acquire))
+				break;
+
+			if (!starving) {
+				primRingStarve++;
+				starving = true;
+			}
+			std::this_thread::yield();
+			continue;
+		}
+		starving = false;
+
+		unsigned int cnt = std::min(tail - head, (unsigned int)TILE_WORKER_BATCH);
+		for (unsigned int i=0; i<cnt; i++)
+			triBatch.push_back(primRing[(head + i) & (PRIM_RING_SIZE-1)]);
+		primRingHead.store(head + cnt, std::memory_order_release);
+
+		FlushTriangleBatch();
+	}
+}
@@ -28,13 +28,20 @@
 #include <string>
 #include <utility>
 #include <algorithm>
-#include <queue>
+#include <vector>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
 
 #include "gpu_config.h"
 #include "gpu_type.h"
 #include "shader_core.h"
+#include "shader_jit.h"
 
 #include "dram/dram.h"
+#include "dram_alloc.h"
 
 #ifdef GPU_INFO
 #	define GPUPRINTF(fmt, ...) \
@@ -64,9 +71,85 @@
 #ifndef START_SPLIT_LEVEL
 #	define START_SPLIT_LEVEL 3
 #endif // START_SPLIT_LEVEL
+#ifndef MAX_SPLIT_LEVEL
+#	define MAX_SPLIT_LEVEL START_SPLIT_LEVEL
+#endif // MAX_SPLIT_LEVEL
+#if MAX_SPLIT_LEVEL < START_SPLIT_LEVEL
+#	error MAX_SPLIT_LEVEL must not be less than START_SPLIT_LEVEL
+#endif
 
 const int SPLIT_WIDTH = pow(2,START_SPLIT_LEVEL+1);
 
+/**
+ *	@brief Fragment pipeline resource owned by one tile worker
+ *
+ *	A tile worker runs tile split, fragment shader and per-fragment operation
+ *	for the screen tiles it owns. Everything it writes during that work lives
+ *	here, so several workers can run concurrently without sharing state.
+ */
+struct tileWorker {
+	int				id; ///< Index in GPU_Core's worker pool
+	const triangle	*tri; ///< Triangle under rasterization
+
+/**
+ *	Fragment accumulator. Quads from different tiles and triangles are
+ *	collected here until a whole shader core batch is filled, or a new quad
+ *	covers a pixel which is already waiting in it.
+ */
+    pixel           pixBuffer[SHADER_EXECUNIT];
+    int             pixBufferP;
+
+/**
+ *	Per-pixel tag on the screen. A pixel is waiting in pixBuffer if its tag
+ *	equals pixBatchTag.
+ */
+	std::vector<int> pixTag;
+	int				pixBatchTag;
+
+/**
+ *	Quad merging. quadSlot is the pixBuffer index of a partially covered quad
+ *	waiting at each screen quad position, valid if its quadTag equals
+ *	pixBatchTag.
+ */
+	std::vector<int> quadTag, quadSlot;
+
+	/// 8x8 HiZ tiles whose depth was written since the last flush
+	std::vector<int> hiZDirty;
+
+	/// Texture cache and DRAM timing bound to each shader core this worker runs
+	textureCache	*texCache;
+
+/**
+ *	Working set of tileScan(), grown on demand to hold every quad of the
+ *	highest start level rasterized so far.
+ */
+	std::vector<int> scanNode;
+	std::vector<float> scanLane;
+
+/// @name Statistic
+/// Merged into GPU_Core's counters after each draw.
+///@{
+	int				totalProcessingPix,
+					totalGhostPix,
+					totalLivePix;
+	int				tileSplitCnt[MAX_SPLIT_LEVEL+1]; ///< Tiles visited at each split level
+	int				earlyZRejectPix; ///< Covered pixels dropped by early-Z
+	int				hiZRejectTile[MAX_SPLIT_LEVEL+1], ///< Tiles dropped by HiZ at each split level
+					hiZRejectPix[MAX_SPLIT_LEVEL+1]; ///< Pixel area of those tiles
+	int				trivialAcceptTile[MAX_SPLIT_LEVEL+1]; ///< Fully covered tiles at each split level
+	int				mergedQuadCnt; ///< Quads merged into a waiting quad
+	int				rasterTriCnt[4]; ///< Triangles in each size bucket
+	long long		rasterNs[4]; ///< Host time of tile split in each size bucket
+	long long		flushNs; ///< Host time spent in FlushFragment()
+	int				fsInstructionCnt,
+					fsScaleOperation;
+	int				fsHelperInstructionCnt, ///< Part of fsInstructionCnt run by helper lanes
+					fsHelperSkipCnt; ///< Lane instructions skipped by helper and idle lanes
+	int				fsDispatchCnt, ///< Fragment batches sent to shader core
+					fsLaneUsed; ///< Enabled lanes summed over all batches
+///@}
+};
+
 /**
  *	The major class for whole GPU hardware design
  */
@@ -76,7 +159,8 @@ public:
 	GPU_Core();
 	~GPU_Core();
 
-	DRAM			dram = DRAM(0x4000000); //simulate an 64MB on-board dram;
+	DRAM			dram = DRAM(DRAM_SIZE);
+	DRAMAllocator	dramAlloc = DRAMAllocator(DRAM_SIZE, TEX_CACHE_BLOCK_SIZE*4); ///< Aligned to texture cache lines
 
     GLenum			drawMode;
     int         	vtxCount;
@@ -88,6 +172,7 @@ public:
     int         	attrSize[MAX_ATTRIBUTE_NUMBER];
     bool        	attrEnable[MAX_ATTRIBUTE_NUMBER];
     bool        	varyEnable[MAX_ATTRIBUTE_NUMBER];
+	unsigned int	varyRead; ///< Components the fragment program needs, see AttribReadMask()
     uint8_t			varyInterpMode[MAX_ATTRIBUTE_NUMBER];
     float       	depthRangeN, depthRangeF;
     int         	viewPortLX, viewPortLY,
@@ -120,7 +205,37 @@ public:
 
     floatVec4		uniformPool[MAX_VERTEX_UNIFORM_VECTORS+MAX_FRAGMENT_UNIFORM_VECTORS];
     int				VSinstCnt, FSinstCnt;
-    instruction		*VSinstPool, *FSinstPool;
+    /// Owned by the linked program, the GPU only reads them
+    const instruction *VSinstPool, *FSinstPool;
+    /// Instruction pools or uniforms changed since the last draw command
+    bool			programDirty;
+	/// Native code of the bound program, only used by SHADER_ENGINE_JIT
+	const ShaderJIT	*VSjit, *FSjit;
+	/// Link-time result of HelperLaneAnalysis() for FSinstPool, may be nullptr
+	const int		*FSrunLane;
+
+/**
+ *	Run geometry and fragment stage in different host threads, connected by
+ *	the primitive ring.
+ */
+	bool			decoupledPipeline;
+
+/// @name Post-transform vertex cache configuration
+///@{
+	int				vtxCacheSize; ///< Entry count, 0 to disable
+	int				vtxCachePolicy; ///< VTX_CACHE_FIFO or VTX_CACHE_PERFECT
+///@}
+
+	int				shaderEngine; ///< SHADER_ENGINE_AOS, _SOA or _JIT
+	bool			earlyZEnable; ///< Allow early-Z for programs which permit it
+	bool			hiZEnable; ///< Allow hierarchical Z when the draw permits it
+	int				rasterizer; ///< RASTERIZER_RECURSIVE or RASTERIZER_SCAN
+	float			guardBand; ///< Clip X/Y only outside this many viewports
+	bool			fixedPointRaster; ///< Snap vertices and rasterize in integers
+	bool			smallTriangleEnable; ///< Let tiny triangles skip tile split
+	bool			adaptiveSplitEnable; ///< Choose the start split level per triangle
+	bool			quadMergeEnable; ///< Merge partial quads carrying the same shader inputs
+	bool			helperLaneMaskEnable; ///< Let helper lanes skip what their quad does not need
 
     uint32_t		clearMask;
     bool			clearStat;
@@ -135,25 +250,119 @@ public:
 					totalCulledPrimitive,
 					totalClippedPrimitive,
 					totalGeneratedPrimitive,
+					guardBandClipCnt, ///< Clipped primitives leaving the guard band
 					totalProcessingVtx,
 					totalProcessingPix,
 					totalGhostPix,
 					totalLivePix;
 	int 			tileSplitCnt;
+	int				tileSplitLevelCnt[MAX_SPLIT_LEVEL+1];
+	int				splitLevelCnt[MAX_SPLIT_LEVEL+1]; ///< Triangles starting from each split level
+	int				earlyZRejectPix;
+	int				hiZRejectTile[MAX_SPLIT_LEVEL+1], hiZRejectPix[MAX_SPLIT_LEVEL+1];
+	int				trivialAcceptTile[MAX_SPLIT_LEVEL+1];
+	int				mergedQuadCnt;
+	int				triSizeCnt[3]; ///< Rasterized triangles in each TRI_SIZE_* class
+	int				emptyTriangleCnt; ///< Tiny triangles covering no pixel center
+	int				rasterTriCnt[4];
+	long long		rasterNs[4];
+	int				vtxCacheHit, vtxCacheMiss;
+	int				vsInstructionCnt, vsScaleOperation,
+					fsInstructionCnt, fsScaleOperation;
+	int				fsHelperInstructionCnt, fsHelperSkipCnt;
+	int				fsDispatchCnt, fsLaneUsed;
+	int				primRingStall, ///< Pushes that found the ring full
+					primRingStarve, ///< Times fragment stage found the ring empty
+					primRingMaxOccupancy;
+	long long		primRingOccupancySum; ///< Ring occupancy summed at each push
+	int				primRingPushCnt;
 ///@}
 
     void        	Run();
     void 			PassConfig2SubModule();
 
+/**
+ *	Set how many tile workers run the fragment pipeline. Worker 0 is the
+ *	calling thread itself, the others are host threads waiting for triangle
+ *	batches. Every screen tile is owned by exactly one worker, so the output is
+ *	identical to the serial one whatever the worker count is.
+ *
+ *	@param workerCnt Tile worker count, 1 for serial fragment pipeline.
+ */
+	void			SetTileWorker(int workerCnt);
+	int				GetTileWorker() const { return tileWorkerCnt; }
+
 private:
-	ShaderCore		sCore[MAX_SHADER_CORE];
+	ShaderCore		*sCore[MAX_SHADER_CORE];
+	textureCache	*vsTexCache; ///< Texture cache of the vertex shader batches
+
+/**
+ *	@name Shader core scheduler
+ *	Vertex and fragment batches do not own any shader core. Each batch takes a
+ *	ticket and waits in arrival order until it is at the head of the queue and
+ *	a core is idle, then it runs on the idle core with the lowest id.
+ */
+///@{
+	std::mutex		coreMutex;
+	std::condition_variable coreIdleCV;
+	bool			coreBusy[MAX_SHADER_CORE];
+	unsigned int	coreTicketHead, coreTicketTail;
+
+	int				AcquireShaderCore();
+	void			ReleaseShaderCore(int cid);
+///@}
 
 	//Geometry
+	vertex			vtxBatch[SHADER_EXECUNIT]; ///< Vertices fed to primitive assembly
+	vertex			vtxShadeBuf[SHADER_EXECUNIT]; ///< Vertices shaded in one shader core run
 	vertex      	curVtx;
+
+/**
+ *	@name Post-transform vertex cache
+ *	Entries are kept in vtxCache and located by vertex index via vtxCacheMap.
+ *	In FIFO policy, vtxCacheHead points to the next entry to be replaced.
+ */
+///@{
+	struct vtxCacheEntry {
+		uint32_t	idx; ///< Vertex index
+		int			lane; ///< Shading lane in vtxShadeBuf, -1 if vtx is ready
+		vertex		vtx; ///< Shaded vertex
+	};
+	std::vector<vtxCacheEntry> vtxCache;
+	std::unordered_map<uint32_t, int> vtxCacheMap;
+	int				vtxCacheHead;
+///@}
 	floatVec4		curClipCoord;
 
-	primitive   	prim, curPrim;
-	std::queue<primitive> primFIFO;
+	/// Decoded form of VSinstPool and FSinstPool, lowered once per draw command
+	std::vector<decodedInst> VSdecPool, FSdecPool;
+	/// Constant tables of VSjit and FSjit for this draw command
+	std::vector<float> VSjitConst, FSjitConst;
+
+	/// Components of each varying EmitQuad() interpolates in this draw command
+	int				varyComp[MAX_ATTRIBUTE_NUMBER];
+
+	/// Depth test runs before fragment shading in this draw command
+	bool			earlyZ;
+
+/**
+ *	@name Hierarchical Z
+ *	Max depth of each 8x8 and 16x16 screen tile. It is rebuilt from the depth
+ *	buffer at the start of a draw command which uses it, and every 8x8 tile
+ *	written by a fragment batch is recomputed when the batch is flushed.
+ */
+///@{
+	bool			hiZ; ///< Hierarchical Z is used in this draw command
+	std::vector<float> hiZ8, hiZ16;
+	int				hiZ8W, hiZ8H, hiZ16W, hiZ16H;
+	std::vector<uint8_t> hiZDirtyFlag;
+///@}
+
+	triangle		prim;
+	primitive   	curPrim;
+
+///	Triangles left of curPrim after Clipping()
+	primitive		clipPrim[CLIP_VERTEX_MAX-2];
 
 /// @name Primitive Assembly related member
 ///@{
@@ -163,73 +372,195 @@ private:
     bool         	stripIndicator;
 ///@}
 
-	//Rasterizer
-	float           Edge[3][3]; ///< Edge equation's coefficient
-    float           area2Reciprocal;
+/// @name Tile worker pool
+///@{
+	int				tileWorkerCnt;
+	std::vector<tileWorker*> tWorker;
+	std::vector<std::thread> workerThread;
+	std::vector<triangle> triBatch; ///< Set-up triangles waiting for rasterization
+
+	std::mutex		workerMutex;
+	std::condition_variable workerStartCV, workerDoneCV;
+	int				workerJobID; ///< Increased each time a batch is released
+	int				workerBusyCnt;
+	bool			workerExit;
+///@}
 
 /**
- *	@name Boundary Box
- *	Target primitive's draw boundary box
- *	        ************ (RX,HY)
- *	        *          *
- *	        *  SCREEN  *
- *	        *          *
- *	(LX,LY) ************
+ *	@name Primitive ring
+ *	Single-producer/single-consumer ring from geometry stage (the thread
+ *	calling Run()) to the fragment stage thread. Head and tail only grow, the
+ *	slot is picked by masking them with PRIM_RING_SIZE-1.
  */
 ///@{
-    int				LX, RX, LY, HY;
+	std::vector<triangle> primRing;
+	std::atomic<unsigned int> primRingHead, primRingTail;
+	std::atomic<bool> geometryDone;
+	std::thread		fragmentThread;
 ///@}
 
-    pixel           pixBuffer[SPLIT_WIDTH * SPLIT_WIDTH];
-    int             pixBufferP;
-
 
 /// @name Invoke Shader Core
 ///@{
-    void 			VertexShaderEXE(int sid, vertex *vtxIn);
-    void 			FragmentShaderEXE(int sid, int &startCnt);
+    void 			VertexShaderEXE(vertex *vtx, int vtxCnt);
+    void 			FragmentShaderEXE(tileWorker &tw, int &startCnt);
 ///@}
 
 /// @name Geometry
 ///@{
 
+/**
+ *  Resolve the vertex index of the vCnt-th vertex in current draw command.
+ */
+    uint32_t		GetVertexIndex(uint32_t vCnt);
+
 /**
  *  Fetch vertex data
  *
- *  @param vCnt Vertex index
+ *  @param vIdx Vertex index
+ *  @param vtx Destination vertex
  */
-    void			FetchVertexData(uint32_t vCnt);
+    void			FetchVertexData(uint32_t vIdx, vertex *vtx);
+
+/**
+ *	Fetch and shade the vertices [vBase, vBase+vtxCnt) of current draw command
+ *	into vtxBatch. In DrawElements, vertices found in the post-transform vertex
+ *	cache are copied from it instead of being shaded again.
+ */
+	void			ShadeVertexBatch(int vBase, int vtxCnt);
+	void			ClearVertexCache();
     void        	PerspectiveDivision(vertex *vtx);
     void        	ViewPort(vertex *vtx);
     void        	InitPrimitiveAssembly();
-    void        	PrimitiveAssembly();
+
+///	@return true when curPrim holds a new primitive
+    bool        	PrimitiveAssembly();
 
 /**
- *	The clipping function will only clip zNear plane cause whole system is at
- *	high precious floating point and no need to clip except for w < 0 situation.
+ *	Clip curPrim in homogeneous space and put what is left into clipPrim. The
+ *	near and far planes are always clipped. The other planes are only clipped
+ *	when a vertex lies outside the guard band, since the rasterizer scissors to
+ *	the viewport anyway.
+ *	@return How many triangles are in clipPrim, 0 if curPrim is culled
  */
-    void        	Clipping();
+    int        		Clipping();
+
+/**
+ *	Take prim from perspective division to EmitTriangle(), unless it is culled
+ *	or covers no pixel on the way.
+ */
+	void			SetupAndEmit();
     void            TriangleSetup();
     void        	Culling();
+
+/**
+ *	Build the fixed-point edge functions of prim after Culling() has made its
+ *	winding counter-clockwise. A triangle whose snapped area is not positive is
+ *	culled.
+ */
+	void			EdgeSetupFixed();
+
+/**
+ *	Test the quads of a tiny triangle in prim and keep their coverage in
+ *	prim.quadCover, so it can skip tile split.
+ */
+	void			QuadCoverSetup();
+
+	/// Set up the attribute planes of prim for the varyings in varyComp.
+	void			AttribPlaneSetup();
 ///@}
 
 /// @name Rasterizer
 ///@{
 
 /**
- *  This function will start in level 3(16x16 tile) and execute recursively
+ *  This function will start in the triangle's splitLevel and execute recursively
  *  until the level 0 is reached(2x2 quad), and then interpolation the all 4 pixel's
  *  data.
  *
+ *  @param tw Tile worker which owns this tile
  *  @param x Start point(x,y)'s x
  *  @param y Start point(x,y)'s y
  *  @param level Indicate the tileSplit's executing level
  */
-    void            tileSplit(int x, int y, int level);
-    void            PerFragmentOp(const pixel &pixInput);
+    void            tileSplit(tileWorker &tw, int x, int y, int level);
+
+/**
+ *	Rasterize a tile breadth-first with host SIMD edge tests. It emits the
+ *	same quads as tileSplit(tw, x, y, level).
+ */
+	void			tileScan(tileWorker &tw, int x, int y, int level);
+
+/**
+ *	Same traversal as tileSplit() on the fixed-point edge functions. Used by
+ *	both backends when fixedPointRaster is set.
+ */
+	void			tileSplitFixed(tileWorker &tw, int x, int y, int level);
+	void			EmitQuad(tileWorker &tw, int x, int y, const float pixTest[4][3],
+							 int coverMask);
+	void			EmitTile(tileWorker &tw, int x, int y, int level);
+
+/**
+ *	Emit the covered quads of a tiny triangle which lie in the worker's
+ *	screen tiles, in the order tile split would visit them.
+ */
+	void			EmitTinyTriangle(tileWorker &tw);
+
+	/// Is the START_SPLIT_LEVEL screen tile at (x, y) owned by the tile worker?
+	bool			OwnTile(const tileWorker &tw, int x, int y) const
+	{
+		return (x/SPLIT_WIDTH + y/SPLIT_WIDTH) % tileWorkerCnt == tw.id;
+	}
+    void            PerFragmentOp(tileWorker &tw, const pixel &pixInput);
+	bool			DepthTest(float z, int bufOffset) const;
+	bool			HiZReject(tileWorker &tw, int x, int y, int level);
+	void			BuildHiZ();
+	void			UpdateHiZ(int tile);
+
+/**
+ *	Shade all fragments waiting in tile worker's pixBuffer and write them into
+ *	frame buffer in the order they were emitted.
+ */
+	void			FlushFragment(tileWorker &tw);
     void 			ClearBuffer(uint32_t mask);
 ///@}
 
+/// @name Tile worker
+///@{
+
+/**
+ *	Rasterize all triangles in triBatch, but only the screen tiles owned by the
+ *	given worker. Triangles are visited in submission order, so each pixel sees
+ *	the same sequence of fragments as the serial pipeline.
+ */
+	void			RasterizeBatch(int wid);
+
+/**
+ *	Hand triBatch to all tile workers and wait until they finish.
+ */
+	void			FlushTriangleBatch();
+	void			TileWorkerLoop(int wid, int lastJobID);
+///@}
+
+/// @name Geometry/fragment stage decoupling
+///@{
+
+/**
+ *	Send the set-up triangle in prim to the fragment stage, either by
+ *	collecting it into triBatch directly or by pushing it into the primitive
+ *	ring in decoupled mode.
+ */
+	void			EmitTriangle();
+
+/**
+ *	Fragment stage thread body in decoupled mode. It drains the primitive ring
+ *	into triBatch and hands it to the tile workers until geometry stage is done
+ *	and the ring is empty.
+ */
+	void			FragmentStageLoop();
+	void			StopTileWorker();
+///@}
+
 };
 
 extern GPU_Core gpu;
@@ -70,10 +70,73 @@ public:
 };
 
 struct primitive {
-	primitive() : iskilled(false), isGenerated(false) {}
+	primitive() : iskilled(false) {}
 
-	bool iskilled, isGenerated;
+	bool iskilled;
     vertex v[3];
 };
 
+/**
+ *	@brief Triangle class (derived from primitive)
+ *
+ *	A primitive with its triangle setup result attached. It carries everything
+ *	the rasterizer needs, so a set-up triangle can be queued and rasterized
+ *	later by any tile worker.
+ */
+struct triangle : public primitive {
+	triangle& operator=(const primitive &rhs)
+	{
+		primitive::operator=(rhs);
+		return *this;
+	}
+
+	float           Edge[3][3]; ///< Edge equation's coefficient
+    float           area2Reciprocal;
+    float			zMin; ///< Lower bound of the depth of every covered pixel
+
+/**
+ *	@name Fixed-point edge function
+ *	Edge i is EdgeFx[i][0]*X + EdgeFx[i][1]*Y + EdgeFx[i][2] with X and Y in
+ *	SUBPIXEL_BITS fixed point. A pixel center is covered if every edge is at
+ *	least edgeBiasFx, which is 0 on a top or left edge and 1 otherwise.
+ */
+///@{
+    int64_t			EdgeFx[3][3];
+    int				edgeBiasFx[3];
+///@}
+
+/**
+ *	@name Boundary Box
+ *	Target primitive's draw boundary box
+ *	        ************ (RX,HY)
+ *	        *          *
+ *	        *  SCREEN  *
+ *	        *          *
+ *	(LX,LY) ************
+ */
+///@{
+    int				LX, RX, LY, HY;
+///@}
+
+	int				sizeClass; ///< TRI_SIZE_TINY, TRI_SIZE_SMALL or TRI_SIZE_LARGE
+	int				splitLevel; ///< Level tile split starts from
+
+/**
+ *	Pixel coverage of a tiny triangle's quads, found at triangle setup. Bits
+ *	4*q to 4*q+3 belong to the q-th quad of its boundary box in row-major
+ *	order. It is 0 if the triangle goes through tile split instead.
+ */
+	uint16_t		quadCover;
+
+/**
+ *	@name Attribute plane
+ *	Attribute a at barycentric position (b0, b1) is
+ *	v[0].attr[a] + planeA[a]*b0 + planeB[a]*b1. Only attribute 0 and the
+ *	varyings interpolated for the draw are set up.
+ */
+///@{
+	floatVec4		planeA[MAX_ATTRIBUTE_NUMBER], planeB[MAX_ATTRIBUTE_NUMBER];
+///@}
+};
+
 #endif // GPU_TYPE_H_INCLUDED
@@ -21,10 +21,204 @@
  */
 
 #include "gpu_core.h"
+#include <chrono>
 
-void GPU_Core::tileSplit(int x, int y, int level)
+static inline long long HostNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// Size bucket of a triangle by its bounding box area, see rasterBucketName
+static inline int RasterBucket(const triangle &tri)
+{
+	int area = (tri.RX - tri.LX + 1)*(tri.HY - tri.LY + 1);
+	return (area <= 64)? 0 : (area <= 1024)? 1 : (area <= 16384)? 2 : 3;
+}
+
+/// Tile offset of the i-th quad in tileSplit()'s visiting order
+static inline void MortonQuad(int i, int &dx, int &dy)
+{
+	dx = dy = 0;
+	for (int b=0; i; b++, i>>=2) {
+		dx |= (i & 1) << (b+1);
+		dy |= ((i>>1) & 1) << (b+1);
+	}
+}
+
+/// Inverse of MortonQuad(), the visiting order of the quad at tile offset (dx, dy)
+static inline int MortonIndex(int dx, int dy)
+{
+	int i = 0;
+	for (int b=0; (dx|dy)>>(b+1); b++) {
+		i |= ((dx>>(b+1)) & 1) << (2*b);
+		i |= ((dy>>(b+1)) & 1) << (2*b+1);
+	}
+	return i;
+}
+
+/**
+ *	Edge functions at the 4 pixel centers of the quad at (x, y), computed the
+ *	same way as the last level of tileSplit().
+ *
+ *	@return Coverage mask, bit i is set if pixel i is inside all 3 edges.
+ */
+static inline int QuadTest(const triangle &tri, int x, int y, float pixTest[4][3])
+{
+	int coverMask = 0;
+
+/*
+ * pixTest: 2 3 for the pixel in pixel stamp: 2 3
+ *          0 1                               0 1
+ */
+	for (int lc=0; lc<3; lc++) {
+		const floatVec4 &v = tri.v[(lc+1)%3].attr[0];
+		float centralTest = (x+1-v.x)*tri.Edge[lc][0] - (y+1-v.y)*tri.Edge[lc][1];
+
+		pixTest[0][lc] = centralTest + (-tri.Edge[lc][0]+tri.Edge[lc][1])*0.5;
+		pixTest[1][lc] = centralTest + ( tri.Edge[lc][0]+tri.Edge[lc][1])*0.5;
+		pixTest[2][lc] = centralTest + (-tri.Edge[lc][0]-tri.Edge[lc][1])*0.5;
+		pixTest[3][lc] = centralTest + ( tri.Edge[lc][0]-tri.Edge[lc][1])*0.5;
+	}
+
+	for (int i=0; i<4; i++) {
+		if (pixTest[i][0]>=0 && pixTest[i][1]>=0 && pixTest[i][2]>=0)
+			coverMask |= 1<<i;
+	}
+	return coverMask;
+}
+
+/// QuadTest() on the fixed-point edge functions, with the top-left rule
+static inline int QuadTestFixed(const triangle &tri, int x, int y, float pixTest[4][3])
+{
+	const int64_t one = 1<<SUBPIXEL_BITS, half = one/2;
+	int coverMask = 0;
+
+	for (int i=0; i<4; i++) {
+		int64_t X = (x + (i&1))*one + half;
+		int64_t Y = (y + (i>>1))*one + half;
+		bool covered = true;
+
+		for (int lc=0; lc<3; lc++) {
+			int64_t e = tri.EdgeFx[lc][0]*X + tri.EdgeFx[lc][1]*Y + tri.EdgeFx[lc][2];
+			pixTest[i][lc] = (float)e;
+			covered &= (e >= tri.edgeBiasFx[lc]);
+		}
+		if (covered)
+			coverMask |= 1<<i;
+	}
+	return coverMask;
+}
+
+/**
+ *	Does the quad waiting in the accumulator feed the fragment program exactly
+ *	the same inputs as the new quad, pixel by pixel? Both hold the values of
+ *	their own triangle on covered pixels and its extrapolation on ghost ones,
+ *	so then every lane computes the same DDX/DDY and texture LOD as it would
+ *	in a quad of its own triangle.
+ *
+ *	@param waiting,stamp The two quads.
+ *	@param varyComp Interpolated components of each varying.
+ *	@param posRead Components of the fragment position the program reads.
+ */
+static inline bool SameQuadInput(const pixel *waiting, const pixel *stamp,
+								 const int *varyComp, int posRead)
+{
+	for (int i=0; i<4; i++) {
+		for (int a=0; a<MAX_ATTRIBUTE_NUMBER; a++) {
+			const int comp = (a == 0)? posRead : varyComp[a];
+
+			for (int c=0; c<4; c++) {
+				if ((comp & (1<<c)) &&
+					Component(waiting[i].attr[a], c) != Component(stamp[i].attr[a], c))
+					return false;
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ *	Emit every quad of a trivially accepted tile without splitting it. The
+ *	pixel coverage is still taken from QuadTest(), so a pixel center rounding
+ *	to just outside an edge is dropped exactly as tileSplit() would drop it.
+ */
+void GPU_Core::EmitTile(tileWorker &tw, int x, int y, int level)
+{
+	const triangle &tri = *tw.tri;
+	float pixTest[4][3];
+
+	for (int i=0; i<(1<<(2*level)); i++) {
+		int dx, dy;
+		MortonQuad(i, dx, dy);
+		if (x+dx > tri.RX || y+dy > tri.HY)
+			continue;
+
+		int coverMask = QuadTest(tri, x+dx, y+dy, pixTest);
+		if (coverMask != 0)
+			EmitQuad(tw, x+dx, y+dy, pixTest, coverMask);
+	}
+}
+
+void GPU_Core::QuadCoverSetup()
+{
+	float pixTest[4][3];
+
+	prim.quadCover = 0;
+	for (int q=0; q<4; q++) {
+		int x = prim.LX + (q&1)*2, y = prim.LY + (q>>1)*2;
+		if (x > prim.RX || y > prim.HY)
+			continue;
+
+		int coverMask = fixedPointRaster? QuadTestFixed(prim, x, y, pixTest) :
+										  QuadTest(prim, x, y, pixTest);
+		prim.quadCover |= coverMask << (4*q);
+	}
+}
+
+void GPU_Core::EmitTinyTriangle(tileWorker &tw)
+{
+	const triangle &tri = *tw.tri;
+	int quad[4], cnt = 0;
+	long long key[4];
+	float pixTest[4][3];
+
+	/* Sort the quads by screen tile as RasterizeBatch() visits them, then by
+	 * tileSplit()'s order inside the tile, so the fragments reach the pixel
+	 * buffer in the same order as without this fast path.
+	 */
+	for (int q=0; q<4; q++) {
+		int x = tri.LX + (q&1)*2, y = tri.LY + (q>>1)*2;
+		if (((tri.quadCover >> (4*q)) & 0xf) == 0 || !OwnTile(tw, x, y))
+			continue;
+
+		long long k = ((long long)(y/SPLIT_WIDTH) << 40) |
+					  ((long long)(x/SPLIT_WIDTH) << 20) |
+					  MortonIndex(x%SPLIT_WIDTH, y%SPLIT_WIDTH);
+		int i = cnt++;
+		for (; i>0 && key[i-1] > k; i--) {
+			key[i] = key[i-1];
+			quad[i] = quad[i-1];
+		}
+		key[i] = k;
+		quad[i] = q;
+	}
+
+	for (int i=0; i<cnt; i++) {
+		int x = tri.LX + (quad[i]&1)*2, y = tri.LY + (quad[i]>>1)*2;
+		if (hiZ && HiZReject(tw, x, y, 0))
+			continue;
+
+		int coverMask = fixedPointRaster? QuadTestFixed(tri, x, y, pixTest) :
+										  QuadTest(tri, x, y, pixTest);
+		EmitQuad(tw, x, y, pixTest, coverMask);
+	}
+}
+
+void GPU_Core::tileSplit(tileWorker &tw, int x, int y, int level)
 {
 	int lc; //loop counter
+	const triangle &tri = *tw.tri;
 
 /*
  * c - central
@@ -38,157 +232,57 @@ void GPU_Core::tileSplit(int x, int y, int level)
 	float cornerTest[8][3];
 	bool Zone[4][3];
 
-/*
- * pixel stamp: 2 3
- *              0 1
- * We need to calculate 4 pixels in quad concurrently for the DDX/Y instruction
- * and texture scale factor calculation later time in shader core.
- */
-	pixel pixelStamp[4];
+	/* A tile above START_SPLIT_LEVEL may hold screen tiles of other workers.
+	 * Every worker walks it, only the owner of its first screen tile counts it.
+	 */
+	if (level == START_SPLIT_LEVEL && !OwnTile(tw, x, y))
+		return;
 
-	tileSplitCnt++;
+	if (level <= START_SPLIT_LEVEL || OwnTile(tw, x, y))
+		tw.tileSplitCnt[level]++;
 
+	if (hiZ && HiZReject(tw, x, y, level))
+		return;
 
 	PIXPRINTF("-------(%d,%d),Level:%d-----\n",x,y,level);
 
-	centralTest[0] = (x+(1<<level)-prim.v[1].attr[0].x)*Edge[0][0]-
-					 (y+(1<<level)-prim.v[1].attr[0].y)*Edge[0][1];
-	centralTest[1] = (x+(1<<level)-prim.v[2].attr[0].x)*Edge[1][0]-
-					 (y+(1<<level)-prim.v[2].attr[0].y)*Edge[1][1];
-	centralTest[2] = (x+(1<<level)-prim.v[0].attr[0].x)*Edge[2][0]-
-					 (y+(1<<level)-prim.v[0].attr[0].y)*Edge[2][1];
-
 	if (level == 0) { //Reach the 2x2 pixel stamp
+		float pixTest[4][3];
+		int coverMask = QuadTest(tri, x, y, pixTest);
+		EmitQuad(tw, x, y, pixTest, coverMask);
+	}
+	else {
+		centralTest[0] = (x+(1<<level)-tri.v[1].attr[0].x)*tri.Edge[0][0]-
+						 (y+(1<<level)-tri.v[1].attr[0].y)*tri.Edge[0][1];
+		centralTest[1] = (x+(1<<level)-tri.v[2].attr[0].x)*tri.Edge[1][0]-
+						 (y+(1<<level)-tri.v[2].attr[0].y)*tri.Edge[1][1];
+		centralTest[2] = (x+(1<<level)-tri.v[0].attr[0].x)*tri.Edge[2][0]-
+						 (y+(1<<level)-tri.v[0].attr[0].y)*tri.Edge[2][1];
 
-/*
- * When split level is 1, the cornerTests are used for each pixel's center test,
- * and not for corner test anymore.
- *
- * cornerTest: 5 7 for the pixel in pixel stamp: 2 3
- *             0 2                               0 1
- */
 		for(lc=0; lc<3; lc++) {
-			cornerTest[0][lc] = centralTest[lc] + (-Edge[lc][0]+Edge[lc][1])*0.5;
-			cornerTest[2][lc] = centralTest[lc] + ( Edge[lc][0]+Edge[lc][1])*0.5;
-			cornerTest[5][lc] = centralTest[lc] + (-Edge[lc][0]-Edge[lc][1])*0.5;
-			cornerTest[7][lc] = centralTest[lc] + ( Edge[lc][0]-Edge[lc][1])*0.5;
-		}
-
-		pixelStamp[0].attr[0].x = x;
-		pixelStamp[0].attr[0].y = y;
-		pixelStamp[0].baryCenPos3[0] = cornerTest[0][2]*area2Reciprocal;
-		pixelStamp[0].baryCenPos3[1] = cornerTest[0][0]*area2Reciprocal;
-		pixelStamp[1].attr[0].x = x+1;
-		pixelStamp[1].attr[0].y = y;
-		pixelStamp[1].baryCenPos3[0] = cornerTest[2][2]*area2Reciprocal;
-		pixelStamp[1].baryCenPos3[1] = cornerTest[2][0]*area2Reciprocal;
-		pixelStamp[2].attr[0].x = x;
-		pixelStamp[2].attr[0].y = y+1;
-		pixelStamp[2].baryCenPos3[0] = cornerTest[5][2]*area2Reciprocal;
-		pixelStamp[2].baryCenPos3[1] = cornerTest[5][0]*area2Reciprocal;
-		pixelStamp[3].attr[0].x = x+1;
-		pixelStamp[3].attr[0].y = y+1;
-		pixelStamp[3].baryCenPos3[0] = cornerTest[7][2]*area2Reciprocal;
-		pixelStamp[3].baryCenPos3[1] = cornerTest[7][0]*area2Reciprocal;
-
-		//Interpolate the all 4 pixel's attributes, then perform perspective division
-
-		floatVec4 invW;
-		for (int i=0; i<4; i++){
-			pixelStamp[i].attr[0].z =
-				prim.v[0].attr[0].z +
-				pixelStamp[i].baryCenPos3[0]*( prim.v[1].attr[0].z - prim.v[0].attr[0].z ) +
-				pixelStamp[i].baryCenPos3[1]*( prim.v[2].attr[0].z - prim.v[0].attr[0].z );
-			pixelStamp[i].attr[0].w =
-				prim.v[0].attr[0].w +
-				pixelStamp[i].baryCenPos3[0]*( prim.v[1].attr[0].w - prim.v[0].attr[0].w ) +
-				pixelStamp[i].baryCenPos3[1]*( prim.v[2].attr[0].w - prim.v[0].attr[0].w );
-
-			invW = fvrcp(floatVec4(pixelStamp[i].attr[0].w));
-
-			for (int attrCnt=1; attrCnt<MAX_ATTRIBUTE_NUMBER; attrCnt++){
-				if (!varyEnable[attrCnt])
-					continue;
-
-				pixelStamp[i].attr[attrCnt] =
-					prim.v[0].attr[attrCnt] +
-					( prim.v[1].attr[attrCnt] - prim.v[0].attr[attrCnt] )*pixelStamp[i].baryCenPos3[0] +
-					( prim.v[2].attr[attrCnt] - prim.v[0].attr[attrCnt] )*pixelStamp[i].baryCenPos3[1];
-
-				/* The normalize modifier here will perform normalization to the
-				 * specified attribute. This step will also avoid additional
-				 * perspective division.
-				 */
-				if (bool(varyInterpMode[attrCnt] & INTERP_NORMALIZE) == true) {
-					float invDistance = pixelStamp[i].attr[attrCnt].x * pixelStamp[i].attr[attrCnt].x +
-										pixelStamp[i].attr[attrCnt].y * pixelStamp[i].attr[attrCnt].y +
-										pixelStamp[i].attr[attrCnt].z * pixelStamp[i].attr[attrCnt].z;
-					invDistance = Q_rsqrt(invDistance);
-					pixelStamp[i].attr[attrCnt] =
-						pixelStamp[i].attr[attrCnt] * invDistance;
-				}
-				else {
-					if (bool(varyInterpMode[attrCnt] & INTERP_NOPERSPECTIVE) == false)
-						pixelStamp[i].attr[attrCnt] =
-							pixelStamp[i].attr[attrCnt] * invW;
-				}
-			}
+			cornerTest[0][lc] = centralTest[lc] + (-tri.Edge[lc][0]+tri.Edge[lc][1])*(1<<level);
+			cornerTest[1][lc] = centralTest[lc] + (            +tri.Edge[lc][1])*(1<<level);
+			cornerTest[2][lc] = centralTest[lc] + ( tri.Edge[lc][0]+tri.Edge[lc][1])*(1<<level);
+			cornerTest[3][lc] = centralTest[lc] + (-tri.Edge[lc][0]            )*(1<<level);
+			cornerTest[4][lc] = centralTest[lc] + ( tri.Edge[lc][0]            )*(1<<level);
+			cornerTest[5][lc] = centralTest[lc] + (-tri.Edge[lc][0]-tri.Edge[lc][1])*(1<<level);
+			cornerTest[6][lc] = centralTest[lc] + (            -tri.Edge[lc][1])*(1<<level);
+			cornerTest[7][lc] = centralTest[lc] + ( tri.Edge[lc][0]-tri.Edge[lc][1])*(1<<level);
 		}
 
-        /* Drop their ghost flag if they are pass the edge test. But those ghost
-         * pixels will be still pushed into shader core.
+		/* Trivial accept, the 4 outer corners are inside all 3 edges. A tile
+		 * above START_SPLIT_LEVEL is split first to leave out the screen tiles
+		 * of other workers.
 		 */
-		if (cornerTest[0][0]>=0 && cornerTest[0][1]>=0 && cornerTest[0][2]>=0)
-            pixelStamp[0].isGhost = false;
-		if (cornerTest[2][0]>=0 && cornerTest[2][1]>=0 && cornerTest[2][2]>=0)
-            pixelStamp[1].isGhost = false;
-		if (cornerTest[5][0]>=0 && cornerTest[5][1]>=0 && cornerTest[5][2]>=0)
-            pixelStamp[2].isGhost = false;
-		if (cornerTest[7][0]>=0 && cornerTest[7][1]>=0 && cornerTest[7][2]>=0)
-            pixelStamp[3].isGhost = false;
-
-
-		if (pixelStamp[0].isGhost && pixelStamp[1].isGhost &&
-			pixelStamp[2].isGhost && pixelStamp[3].isGhost ) {
+		bool accept = (level <= START_SPLIT_LEVEL);
+		for(lc=0; lc<3; lc++)
+			accept &= (cornerTest[0][lc]>=0) & (cornerTest[2][lc]>=0) &
+					  (cornerTest[5][lc]>=0) & (cornerTest[7][lc]>=0);
+		if (accept) {
+			tw.trivialAcceptTile[level]++;
+			EmitTile(tw, x, y, level);
 			return;
 		}
-		else {
-			pixBuffer[pixBufferP  ] = pixelStamp[0];
-			PIXPRINTF("P:(%4d,%4d)\t", (int)pixBuffer[pixBufferP].attr[0].x,
-									   (int)pixBuffer[pixBufferP].attr[0].y);
-			pixBuffer[pixBufferP++].threadId = totalProcessingPix++;
-			PIXPRINTF("pixel ID: %d\n", totalProcessingPix);
-
-			pixBuffer[pixBufferP  ] = pixelStamp[1];
-			PIXPRINTF("P:(%4d,%4d)\t", (int)pixBuffer[pixBufferP].attr[0].x,
-									   (int)pixBuffer[pixBufferP].attr[0].y);
-			pixBuffer[pixBufferP++].threadId = totalProcessingPix++;
-			PIXPRINTF("pixel ID: %d\n", totalProcessingPix);
-
-			pixBuffer[pixBufferP  ] = pixelStamp[2];
-			PIXPRINTF("P:(%4d,%4d)\t", (int)pixBuffer[pixBufferP].attr[0].x,
-									   (int)pixBuffer[pixBufferP].attr[0].y);
-			pixBuffer[pixBufferP++].threadId = totalProcessingPix++;
-			PIXPRINTF("pixel ID: %d\n", totalProcessingPix);
-
-			pixBuffer[pixBufferP  ] = pixelStamp[3];
-			PIXPRINTF("P:(%4d,%4d)\t", (int)pixBuffer[pixBufferP].attr[0].x,
-									   (int)pixBuffer[pixBufferP].attr[0].y);
-			pixBuffer[pixBufferP++].threadId = totalProcessingPix++;
-			PIXPRINTF("pixel ID: %d\n", totalProcessingPix);
-		}
-	}
-	else {
-		for(lc=0; lc<3; lc++) {
-			cornerTest[0][lc] = centralTest[lc] + (-Edge[lc][0]+Edge[lc][1])*(1<<level);
-			cornerTest[1][lc] = centralTest[lc] + (            +Edge[lc][1])*(1<<level);
-			cornerTest[2][lc] = centralTest[lc] + ( Edge[lc][0]+Edge[lc][1])*(1<<level);
-			cornerTest[3][lc] = centralTest[lc] + (-Edge[lc][0]            )*(1<<level);
-			cornerTest[4][lc] = centralTest[lc] + ( Edge[lc][0]            )*(1<<level);
-			cornerTest[5][lc] = centralTest[lc] + (-Edge[lc][0]-Edge[lc][1])*(1<<level);
-			cornerTest[6][lc] = centralTest[lc] + (            -Edge[lc][1])*(1<<level);
-			cornerTest[7][lc] = centralTest[lc] + ( Edge[lc][0]-Edge[lc][1])*(1<<level);
-		}
 
 		for(lc=0; lc<3; lc++) {
 			Zone[0][lc] = (cornerTest[0][lc]>=0) | (cornerTest[1][lc]>=0) | (cornerTest[3][lc]>=0) | (centralTest[lc]>=0);
@@ -198,56 +292,565 @@ void GPU_Core::tileSplit(int x, int y, int level)
 		}
 
 		if (Zone[0][0] == true && Zone[0][1] == true && Zone[0][2] == true )
-			tileSplit(x, y, level-1);
+			tileSplit(tw, x, y, level-1);
 
 		if (Zone[1][0] == true && Zone[1][1] == true && Zone[1][2] == true )
-			if ( (x + (1<<level)) <= RX )
-				tileSplit(x+(1<<level), y, level-1);
+			if ( (x + (1<<level)) <= tri.RX )
+				tileSplit(tw, x+(1<<level), y, level-1);
 
 		if (Zone[2][0] == true && Zone[2][1] == true && Zone[2][2] == true )
-			if ( (y + (1<<level)) <= HY )
-				tileSplit(x, y+(1<<level), level-1);
+			if ( (y + (1<<level)) <= tri.HY )
+				tileSplit(tw, x, y+(1<<level), level-1);
 
 		if (Zone[3][0] == true && Zone[3][1] == true && Zone[3][2] == true )
-			if ( ((x + (1<<level)) <= RX) && ((y + (1<<level)) <= HY) )
-				tileSplit(x+(1<<level), y+(1<<level), level-1);
+			if ( ((x + (1<<level)) <= tri.RX) && ((y + (1<<level)) <= tri.HY) )
+				tileSplit(tw, x+(1<<level), y+(1<<level), level-1);
+	}
+}
+
+void GPU_Core::tileSplitFixed(tileWorker &tw, int x, int y, int level)
+{
+	const triangle &tri = *tw.tri;
+	const int64_t one = 1<<SUBPIXEL_BITS, half = one/2;
+	const int s = 1<<level;
+	int lc;
+
+	if (level == START_SPLIT_LEVEL && !OwnTile(tw, x, y))
+		return;
+
+	if (level <= START_SPLIT_LEVEL || OwnTile(tw, x, y))
+		tw.tileSplitCnt[level]++;
+
+	if (hiZ && HiZReject(tw, x, y, level))
+		return;
+
+	if (level == 0) {
+		float pixTest[4][3];
+		int coverMask = QuadTestFixed(tri, x, y, pixTest);
+
+		if (coverMask != 0)
+			EmitQuad(tw, x, y, pixTest, coverMask);
+		return;
+	}
+
+/*
+ * Trivial accept if, for every edge, the pixel center of the tile where the
+ * edge function is smallest is inside. Coverage is exact in integers, so the
+ * quads are emitted fully covered without testing each pixel. As in
+ * tileSplit(), a tile above START_SPLIT_LEVEL is never accepted whole.
+ */
+	bool accept = (level <= START_SPLIT_LEVEL);
+	for (lc=0; lc<3 && accept; lc++) {
+		int64_t X = (tri.EdgeFx[lc][0] > 0)? x*one + half : (int64_t)(x+2*s-1)*one + half;
+		int64_t Y = (tri.EdgeFx[lc][1] > 0)? y*one + half : (int64_t)(y+2*s-1)*one + half;
+		accept = (tri.EdgeFx[lc][0]*X + tri.EdgeFx[lc][1]*Y + tri.EdgeFx[lc][2] >= tri.edgeBiasFx[lc]);
+	}
+	if (accept) {
+		tw.trivialAcceptTile[level]++;
+		for (int i=0; i<(1<<(2*level)); i++) {
+			int dx, dy;
+			float pixTest[4][3];
+			MortonQuad(i, dx, dy);
+			if (x+dx > tri.RX || y+dy > tri.HY)
+				continue;
+
+			for (lc=0; lc<3; lc++) {
+				int64_t e = tri.EdgeFx[lc][0]*((x+dx)*one + half) +
+							tri.EdgeFx[lc][1]*((y+dy)*one + half) + tri.EdgeFx[lc][2];
+				pixTest[0][lc] = (float)e;
+				pixTest[1][lc] = (float)(e + tri.EdgeFx[lc][0]*one);
+				pixTest[2][lc] = (float)(e + tri.EdgeFx[lc][1]*one);
+				pixTest[3][lc] = (float)(e + tri.EdgeFx[lc][0]*one + tri.EdgeFx[lc][1]*one);
+			}
+			EmitQuad(tw, x+dx, y+dy, pixTest, 0xf);
+		}
+		return;
+	}
+
+/*
+ * A child tile is visited if, for every edge, the pixel center of the child
+ * where the edge function is largest is not outside. Children are visited in
+ * the same order as tileSplit().
+ */
+	for (int q=0; q<4; q++) {
+		int cx = x + (q&1)*s, cy = y + (q>>1)*s;
+		bool inside = true;
+
+		if ((q&1) && cx > tri.RX)
+			continue;
+		if ((q>>1) && cy > tri.HY)
+			continue;
+
+		for (lc=0; lc<3 && inside; lc++) {
+			int64_t X = (tri.EdgeFx[lc][0] > 0)? (int64_t)(cx+s-1)*one + half : cx*one + half;
+			int64_t Y = (tri.EdgeFx[lc][1] > 0)? (int64_t)(cy+s-1)*one + half : cy*one + half;
+			int64_t e = tri.EdgeFx[lc][0]*X + tri.EdgeFx[lc][1]*Y + tri.EdgeFx[lc][2];
+			inside = (e >= tri.edgeBiasFx[lc]);
+		}
+
+		if (inside)
+			tileSplitFixed(tw, cx, cy, level-1);
 	}
 }
 
 /**
- *	Invoke specified Shader Core for fragment shader processing
+ *	Interpolate a 2x2 quad and push it into the tile worker's pixel buffer.
  *
- *	@param sid Which shader core id will be used.
- *	@param pixIn Input pixel's pointer.
+ *	@param tw Tile worker which owns the quad
+ *	@param x,y Position of the bottom-left pixel
+ *	@param pixTest Edge function of the 3 edges at each pixel center, in the
+ *	pixel stamp order, scaled to barycentric coordinates by area2Reciprocal
+ *	@param coverMask Bit i is set if pixel i passes the edge test
  */
-void GPU_Core::FragmentShaderEXE(int sid, int &startCnt)
+void GPU_Core::EmitQuad(tileWorker &tw, int x, int y, const float pixTest[4][3],
+						int coverMask)
 {
-	int i=0;
+	const triangle &tri = *tw.tri;
+
+/*
+ * pixel stamp: 2 3
+ *              0 1
+ * We need to calculate 4 pixels in quad concurrently for the DDX/Y instruction
+ * and texture scale factor calculation later time in shader core.
+ */
+	pixel pixelStamp[4];
+
+	pixelStamp[0].attr[0].x = x;
+	pixelStamp[0].attr[0].y = y;
+	pixelStamp[0].baryCenPos3[0] = pixTest[0][2]*tri.area2Reciprocal;
+	pixelStamp[0].baryCenPos3[1] = pixTest[0][0]*tri.area2Reciprocal;
+	pixelStamp[1].attr[0].x = x+1;
+	pixelStamp[1].attr[0].y = y;
+	pixelStamp[1].baryCenPos3[0] = pixTest[1][2]*tri.area2Reciprocal;
+	pixelStamp[1].baryCenPos3[1] = pixTest[1][0]*tri.area2Reciprocal;
+	pixelStamp[2].attr[0].x = x;
+	pixelStamp[2].attr[0].y = y+1;
+	pixelStamp[2].baryCenPos3[0] = pixTest[2][2]*tri.area2Reciprocal;
+	pixelStamp[2].baryCenPos3[1] = pixTest[2][0]*tri.area2Reciprocal;
+	pixelStamp[3].attr[0].x = x+1;
+	pixelStamp[3].attr[0].y = y+1;
+	pixelStamp[3].baryCenPos3[0] = pixTest[3][2]*tri.area2Reciprocal;
+	pixelStamp[3].baryCenPos3[1] = pixTest[3][0]*tri.area2Reciprocal;
+
+	/* Drop their ghost flag if they are pass the edge test. But those ghost
+	 * pixels will be still pushed into shader core.
+	 */
+	for (int i=0; i<4; i++) {
+		if (coverMask & (1<<i))
+			pixelStamp[i].isGhost = false;
+	}
+
+	if (pixelStamp[0].isGhost && pixelStamp[1].isGhost &&
+		pixelStamp[2].isGhost && pixelStamp[3].isGhost ) {
+		return;
+	}
+
+	/* Rounding may put a covered pixel slightly outside the triangle. Its
+	 * depth is taken at the nearest point inside, so it stays within the
+	 * bound of TriangleSetup(). Ghost pixels keep the plane for derivatives.
+	 */
+	for (int i=0; i<4; i++){
+		float b0 = pixelStamp[i].baryCenPos3[0], b1 = pixelStamp[i].baryCenPos3[1];
+		if (!pixelStamp[i].isGhost) {
+			b0 = std::min(b0, 1.0f);
+			b1 = std::min(b1, 1.0f - b0);
+		}
+		pixelStamp[i].attr[0].z =
+			tri.v[0].attr[0].z + b0*tri.planeA[0].z + b1*tri.planeB[0].z;
+	}
+
+	/* Flush the accumulator if one of the covered pixels is already waiting
+	 * in it, so fragments on the same pixel still reach the per-fragment
+	 * operation in order, and the depth buffer read by early-Z is the one
+	 * the late depth test will see.
+	 */
+	int bufOffset = y*viewPortW + x;
+	const int stampOffset[4] = {0, 1, viewPortW, viewPortW+1};
+	for (int i=0; i<4; i++) {
+		if (!pixelStamp[i].isGhost &&
+			tw.pixTag[bufOffset+stampOffset[i]] == tw.pixBatchTag) {
+			FlushFragment(tw);
+			break;
+		}
+	}
+
+	/* Early-Z. A quad is only dropped when all of its covered pixels fail,
+	 * the others still have to run as helpers for DDX/DDY.
+	 */
+	if (earlyZ) {
+		int rejectCnt = 0, coverCnt = 0;
+		for (int i=0; i<4; i++) {
+			if (pixelStamp[i].isGhost)
+				continue;
+			coverCnt++;
+			if (!DepthTest(pixelStamp[i].attr[0].z, bufOffset+stampOffset[i]))
+				rejectCnt++;
+		}
+		if (rejectCnt == coverCnt) {
+			tw.earlyZRejectPix += rejectCnt;
+			return;
+		}
+	}
+
+	/* Interpolate the components of the varyings the fragment program reads
+	 * from the attribute planes, then perform perspective division. The
+	 * components left out are cleared.
+	 */
+	float invW;
+	for (int i=0; i<4; i++){
+		const float b0 = pixelStamp[i].baryCenPos3[0], b1 = pixelStamp[i].baryCenPos3[1];
+
+		pixelStamp[i].attr[0].w =
+			tri.v[0].attr[0].w + b0*tri.planeA[0].w + b1*tri.planeB[0].w;
+
+		invW = fvrcp(floatVec4(pixelStamp[i].attr[0].w)).x;
+
+		for (int attrCnt=1; attrCnt<MAX_ATTRIBUTE_NUMBER; attrCnt++){
+			const int comp = varyComp[attrCnt];
+			floatVec4 &attr = pixelStamp[i].attr[attrCnt];
+
+			if (comp == 0)
+				continue;
+
+			for (int c=0; c<4; c++) {
+				Component(attr, c) = (comp & (1<<c))?
+					Component(tri.v[0].attr[attrCnt], c) +
+					Component(tri.planeA[attrCnt], c)*b0 +
+					Component(tri.planeB[attrCnt], c)*b1 : 0.0f;
+			}
+
+			/* The normalize modifier here will perform normalization to the
+			 * specified attribute. This step will also avoid additional
+			 * perspective division.
+			 */
+			if (bool(varyInterpMode[attrCnt] & INTERP_NORMALIZE) == true) {
+				float invDistance = attr.x*attr.x + attr.y*attr.y + attr.z*attr.z;
+				invDistance = Q_rsqrt(invDistance);
+				for (int c=0; c<4; c++)
+					Component(attr, c) *= invDistance;
+			}
+			else if (bool(varyInterpMode[attrCnt] & INTERP_NOPERSPECTIVE) == false) {
+				for (int c=0; c<4; c++)
+					Component(attr, c) *= invW;
+			}
+		}
+	}
+
+	/* Quad merging. The covered pixels of a partial quad replace the ghost
+	 * pixels of the quad waiting at the same position. They cannot overlap,
+	 * since a covered pixel already waiting would have flushed the
+	 * accumulator above. Merging only happens when the two quads carry the
+	 * same inputs, e.g. two halves of a flat-shaded face, so the output is
+	 * exactly the unmerged one whenever the accumulator happens to flush.
+	 */
+	int quadIdx = (y>>1)*((viewPortW+1)>>1) + (x>>1);
+	if (quadMergeEnable && coverMask != 0xf &&
+		tw.quadTag[quadIdx] == tw.pixBatchTag &&
+		SameQuadInput(tw.pixBuffer + tw.quadSlot[quadIdx], pixelStamp,
+					  varyComp, varyRead & 0xf)) {
+		pixel *dst = tw.pixBuffer + tw.quadSlot[quadIdx];
+		int waitMask = 0;
+
+		for (int i=0; i<4; i++) {
+			if (!pixelStamp[i].isGhost) {
+				int threadId = dst[i].threadId;
+				dst[i] = pixelStamp[i];
+				dst[i].threadId = threadId;
+				tw.pixTag[bufOffset+stampOffset[i]] = tw.pixBatchTag;
+			}
+			if (!dst[i].isGhost)
+				waitMask |= 1<<i;
+		}
+		if (waitMask == 0xf)
+			tw.quadTag[quadIdx] = 0;
+		tw.mergedQuadCnt++;
+		return;
+	}
+
+	if (tw.pixBufferP + 4 > SHADER_EXECUNIT)
+		FlushFragment(tw);
+
+	if (!pixelStamp[0].isGhost) tw.pixTag[bufOffset] = tw.pixBatchTag;
+	if (!pixelStamp[1].isGhost) tw.pixTag[bufOffset+1] = tw.pixBatchTag;
+	if (!pixelStamp[2].isGhost) tw.pixTag[bufOffset+viewPortW] = tw.pixBatchTag;
+	if (!pixelStamp[3].isGhost) tw.pixTag[bufOffset+viewPortW+1] = tw.pixBatchTag;
+
+	if (quadMergeEnable && coverMask != 0xf) {
+		tw.quadTag[quadIdx] = tw.pixBatchTag;
+		tw.quadSlot[quadIdx] = tw.pixBufferP;
+	}
+
+	tw.pixBuffer[tw.pixBufferP  ] = pixelStamp[0];
+	PIXPRINTF("P:(%4d,%4d)\t", (int)tw.pixBuffer[tw.pixBufferP].attr[0].x,
+							   (int)tw.pixBuffer[tw.pixBufferP].attr[0].y);
+	tw.pixBuffer[tw.pixBufferP++].threadId = tw.totalProcessingPix++;
+	PIXPRINTF("pixel ID: %d\n", tw.totalProcessingPix);
+
+	tw.pixBuffer[tw.pixBufferP  ] = pixelStamp[1];
+	PIXPRINTF("P:(%4d,%4d)\t", (int)tw.pixBuffer[tw.pixBufferP].attr[0].x,
+							   (int)tw.pixBuffer[tw.pixBufferP].attr[0].y);
+	tw.pixBuffer[tw.pixBufferP++].threadId = tw.totalProcessingPix++;
+	PIXPRINTF("pixel ID: %d\n", tw.totalProcessingPix);
+
+	tw.pixBuffer[tw.pixBufferP  ] = pixelStamp[2];
+	PIXPRINTF("P:(%4d,%4d)\t", (int)tw.pixBuffer[tw.pixBufferP].attr[0].x,
+							   (int)tw.pixBuffer[tw.pixBufferP].attr[0].y);
+	tw.pixBuffer[tw.pixBufferP++].threadId = tw.totalProcessingPix++;
+	PIXPRINTF("pixel ID: %d\n", tw.totalProcessingPix);
+
+	tw.pixBuffer[tw.pixBufferP  ] = pixelStamp[3];
+	PIXPRINTF("P:(%4d,%4d)\t", (int)tw.pixBuffer[tw.pixBufferP].attr[0].x,
+							   (int)tw.pixBuffer[tw.pixBufferP].attr[0].y);
+	tw.pixBuffer[tw.pixBufferP++].threadId = tw.totalProcessingPix++;
+	PIXPRINTF("pixel ID: %d\n", tw.totalProcessingPix);
+}
+
+void GPU_Core::RasterizeBatch(int wid)
+{
+	tileWorker &tw = *tWorker[wid];
+
+	if ((int)tw.pixTag.size() != viewPortW*viewPortH) {
+		tw.pixTag.assign(viewPortW*viewPortH, 0);
+		tw.quadTag.assign(((viewPortW+1)>>1)*((viewPortH+1)>>1), 0);
+		tw.quadSlot.resize(tw.quadTag.size());
+		tw.pixBatchTag = 1;
+	}
+
+	for (int t=0; t<(int)triBatch.size(); t++) {
+		tw.tri = &triBatch[t];
+		long long t0 = HostNs(), flush0 = tw.flushNs;
+
+		/* Tiles are aligned on the screen rather than the boundary box, so every
+		 * triangle touching a pixel reaches it through the same tile and
+		 * therefore the same worker.
+		 */
+		if (tw.tri->quadCover != 0)
+			EmitTinyTriangle(tw);
+		else {
+			const int level = tw.tri->splitLevel, width = 2<<level;
+
+			for(int y=tw.tri->LY & ~(width-1); y<=tw.tri->HY; y+=width) {
+				for(int x=tw.tri->LX & ~(width-1); x<=tw.tri->RX; x+=width) {
+					if (level < START_SPLIT_LEVEL && !OwnTile(tw, x, y))
+						continue;
+
+					PIXPRINTF("Recursive Entry:-------(%d,%d)-----\n",x,y);
+					if (fixedPointRaster)
+						tileSplitFixed(tw, x, y, level);
+					else if (rasterizer == RASTERIZER_SCAN)
+						tileScan(tw, x, y, level);
+					else
+						tileSplit(tw, x, y, level);
+				}
+			}
+		}
+
+		// Shading done by flushes in between is not counted.
+		int bucket = RasterBucket(*tw.tri);
+		tw.rasterTriCnt[bucket]++;
+		tw.rasterNs[bucket] += HostNs() - t0 - (tw.flushNs - flush0);
+	}
+
+	FlushFragment(tw);
+}
+
+void GPU_Core::FlushFragment(tileWorker &tw)
+{
+	if (tw.pixBufferP == 0)
+		return;
 
-	sCore[sid].instPool = FSinstPool;
-	sCore[sid].instCnt = FSinstCnt;
-	sCore[sid].uniformPool = uniformPool;
-	sCore[sid].Init();
+	long long t0 = HostNs();
+	int processedCount=0;
+	while (processedCount < tw.pixBufferP) {
+		FragmentShaderEXE(tw, processedCount);
+	}
+
+	for (int i=0; i<tw.pixBufferP; i++)
+		PerFragmentOp(tw, tw.pixBuffer[i]);
+
+	if (hiZ) {
+		for (int tile : tw.hiZDirty) {
+			UpdateHiZ(tile);
+			hiZDirtyFlag[tile] = 0;
+		}
+		tw.hiZDirty.clear();
+	}
+
+	tw.pixBufferP = 0;
+	tw.pixBatchTag++;
+	tw.flushNs += HostNs() - t0;
+}
+
+/**
+ *	Dispatch a fragment batch from tile worker's pixel buffer to an idle Shader
+ *	Core.
+ *
+ *	@param tw Which tile worker's pixel buffer will be used.
+ *	@param startCnt Index of the first pixel in pixBuffer to be shaded. It
+ *	will be advanced by the number of shaded pixels.
+ */
+void GPU_Core::FragmentShaderEXE(tileWorker &tw, int &startCnt)
+{
+	int i=0;
+	int cid = AcquireShaderCore();
+	ShaderCore *core = sCore[cid];
+	int instCnt = core->totalInstructionCnt;
+	int scaleOp = core->totalScaleOperation;
+	int helperInst = core->helperInstructionCnt;
+	int helperSkip = core->helperSkipCnt;
+
+	core->instPool = FSinstPool;
+	core->decPool = FSdecPool.data();
+	core->jit = (shaderEngine == SHADER_ENGINE_JIT)? FSjit : nullptr;
+	core->jitConst = FSjitConst.data();
+	core->instCnt = FSinstCnt;
+	core->uniformPool = uniformPool;
+	core->texUnit.cache = tw.texCache;
+	core->Init();
+	core->laneMask = helperLaneMaskEnable;
 
 	for (i=0; i<SHADER_EXECUNIT; i++) {
-		if ( (startCnt + i) > pixBufferP )
+		if ( (startCnt + i) >= tw.pixBufferP )
 			break;
 
-        sCore[sid].isEnable[i] = true;
-        sCore[sid].threadPtr[i] = pixBuffer+startCnt+i;
+        core->isEnable[i] = true;
+        core->isHelper[i] = tw.pixBuffer[startCnt+i].isGhost;
+        core->threadPtr[i] = tw.pixBuffer+startCnt+i;
 	}
 
-	sCore[sid].Run();
+	core->Run();
 	startCnt = startCnt + i;
+
+	core->fragmentBatchCnt++;
+	tw.fsDispatchCnt++;
+	tw.fsLaneUsed += i;
+	tw.fsInstructionCnt += core->totalInstructionCnt - instCnt;
+	tw.fsScaleOperation += core->totalScaleOperation - scaleOp;
+	tw.fsHelperInstructionCnt += core->helperInstructionCnt - helperInst;
+	tw.fsHelperSkipCnt += core->helperSkipCnt - helperSkip;
+	ReleaseShaderCore(cid);
 }
 
-void GPU_Core::PerFragmentOp(const pixel &pixInput)
+/**
+ *	Compare a fragment depth with the depth buffer by depthTestMode.
+ *
+ *	@param z Fragment depth.
+ *	@param bufOffset Pixel offset in the depth buffer.
+ *	@return True if the fragment passes.
+ */
+bool GPU_Core::DepthTest(float z, int bufOffset) const
+{
+	switch (depthTestMode) {
+	case GL_NEVER:		return false;
+	case GL_LESS:		return z  < *(dBufPtr + bufOffset);
+	case GL_EQUAL:		return z == *(dBufPtr + bufOffset);
+	case GL_LEQUAL:		return z <= *(dBufPtr + bufOffset);
+	case GL_GREATER:	return z  > *(dBufPtr + bufOffset);
+	case GL_NOTEQUAL:	return z != *(dBufPtr + bufOffset);
+	case GL_GEQUAL:		return z >= *(dBufPtr + bufOffset);
+	default:			return true;
+	}
+}
+
+/**
+ *	Test a tile against hierarchical Z before it is split any further.
+ *
+ *	Tiles above START_SPLIT_LEVEL are never tested. They may cover screen tiles
+ *	of other workers, whose hierarchical Z is rewritten by those workers at the
+ *	same time. Each worker thus only reads the cells it updates itself.
+ *
+ *	@return True if every pixel of the tile fails the depth test, then the
+ *	tile is counted as rejected at its level.
+ */
+bool GPU_Core::HiZReject(tileWorker &tw, int x, int y, int level)
+{
+	float zMax;
+	bool reject;
+
+	if (level > START_SPLIT_LEVEL)
+		return false;
+
+	if (level >= 3) {
+		int tx1 = std::min((x + (2<<level) - 1)>>4, hiZ16W-1);
+		int ty1 = std::min((y + (2<<level) - 1)>>4, hiZ16H-1);
+
+		zMax = hiZ16[(y>>4)*hiZ16W + (x>>4)];
+		for (int ty=y>>4; ty<=ty1; ty++)
+			for (int tx=x>>4; tx<=tx1; tx++)
+				zMax = std::max(zMax, hiZ16[ty*hiZ16W + tx]);
+	}
+	else
+		zMax = hiZ8[(y>>3)*hiZ8W + (x>>3)];
+
+	if (depthTestMode == GL_LESS)
+		reject = tw.tri->zMin >= zMax;
+	else
+		reject = tw.tri->zMin > zMax;
+
+	if (reject) {
+		tw.hiZRejectTile[level]++;
+		tw.hiZRejectPix[level] += 4<<(2*level);
+	}
+	return reject;
+}
+
+/// Rebuild both hierarchical Z levels from the whole depth buffer.
+void GPU_Core::BuildHiZ()
+{
+	hiZ8W = (viewPortW+7)>>3;
+	hiZ8H = (viewPortH+7)>>3;
+	hiZ16W = (viewPortW+15)>>4;
+	hiZ16H = (viewPortH+15)>>4;
+	hiZ8.assign(hiZ8W*hiZ8H, 0);
+	hiZ16.assign(hiZ16W*hiZ16H, 0);
+	hiZDirtyFlag.assign(hiZ8W*hiZ8H, 0);
+
+	for (int i=0; i<hiZ8W*hiZ8H; i++)
+		UpdateHiZ(i);
+}
+
+/**
+ *	Recompute the max depth of an 8x8 tile, and of the 16x16 tile containing
+ *	it if the screen tiles of START_SPLIT_LEVEL are 16x16 or larger. Smaller
+ *	screen tiles of different workers would share a 16x16 cell, and tiles
+ *	above START_SPLIT_LEVEL are never tested against it anyway.
+ */
+void GPU_Core::UpdateHiZ(int tile)
+{
+	int tx = tile % hiZ8W, ty = tile / hiZ8W;
+	int xEnd = std::min((tx+1)<<3, viewPortW);
+	int yEnd = std::min((ty+1)<<3, viewPortH);
+	float zMax = *(dBufPtr + (ty<<3)*viewPortW + (tx<<3));
+
+	for (int y=ty<<3; y<yEnd; y++) {
+		const float *row = dBufPtr + y*viewPortW;
+		for (int x=tx<<3; x<xEnd; x++)
+			zMax = std::max(zMax, row[x]);
+	}
+	hiZ8[tile] = zMax;
+
+	if (START_SPLIT_LEVEL < 3)
+		return;
+
+	tx &= ~1;
+	ty &= ~1;
+	zMax = hiZ8[ty*hiZ8W + tx];
+	if (tx+1 < hiZ8W)
+		zMax = std::max(zMax, hiZ8[ty*hiZ8W + tx+1]);
+	if (ty+1 < hiZ8H) {
+		zMax = std::max(zMax, hiZ8[(ty+1)*hiZ8W + tx]);
+		if (tx+1 < hiZ8W)
+			zMax = std::max(zMax, hiZ8[(ty+1)*hiZ8W + tx+1]);
+	}
+	hiZ16[(ty>>1)*hiZ16W + (tx>>1)] = zMax;
+}
+
+void GPU_Core::PerFragmentOp(tileWorker &tw, const pixel &pixInput)
 {
-	bool DepthPass = true;
 	int bufOffset;
 
 	if (pixInput.isGhost) {
-		totalGhostPix++;
+		tw.totalGhostPix++;
 		return;
 	}
 
@@ -258,27 +861,18 @@ void GPU_Core::PerFragmentOp(const pixel &pixInput)
 
     //Depth test
     if (depthTestEnable){
-        if (depthTestMode == GL_NEVER)
-            DepthPass = false;
-        else if (depthTestMode == GL_LESS)
-            DepthPass = pixInput.attr[0].z  < *(dBufPtr + bufOffset);
-        else if (depthTestMode == GL_EQUAL)
-            DepthPass = pixInput.attr[0].z == *(dBufPtr + bufOffset);
-        else if (depthTestMode == GL_LEQUAL)
-            DepthPass = pixInput.attr[0].z <= *(dBufPtr + bufOffset);
-        else if (depthTestMode == GL_GREATER)
-            DepthPass = pixInput.attr[0].z  > *(dBufPtr + bufOffset);
-        else if (depthTestMode == GL_NOTEQUAL)
-            DepthPass = pixInput.attr[0].z != *(dBufPtr + bufOffset);
-        else if (depthTestMode == GL_GEQUAL)
-            DepthPass = pixInput.attr[0].z >= *(dBufPtr + bufOffset);
-        else if (depthTestMode == GL_ALWAYS)
-            DepthPass = true;
-
-        if (DepthPass == false)
+        if (DepthTest(pixInput.attr[0].z, bufOffset) == false)
             return;
         else
             *(dBufPtr + bufOffset) = pixInput.attr[0].z;
+
+        if (hiZ) {
+            int tile = ((int)pixInput.attr[0].y>>3)*hiZ8W + ((int)pixInput.attr[0].x>>3);
+            if (!hiZDirtyFlag[tile]) {
+                hiZDirtyFlag[tile] = 1;
+                tw.hiZDirty.push_back(tile);
+            }
+        }
     }
 
     //Alpha blending
@@ -295,7 +889,7 @@ void GPU_Core::PerFragmentOp(const pixel &pixInput)
     *(cBufPtr + bufOffset*4 + 2) = color.b;// B
     *(cBufPtr + bufOffset*4 + 3) = color.a;// A
 
-    totalLivePix++;
+    tw.totalLivePix++;
 }
 
 void GPU_Core::ClearBuffer(uint32_t mask)
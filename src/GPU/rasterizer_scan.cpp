@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2013, Liou Jhe-Yu <lioujheyu@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ *	@file rasterizer_scan.cpp
+ *  @brief Breadth-first SIMD rasterizer
+ *
+ *	tileScan() visits the same tile hierarchy as tileSplit(), but one level at
+ *	a time. All tiles alive at a level are gathered into lane arrays and their
+ *	edge functions are evaluated SHADER_SOA_WIDTH tiles per host instruction.
+ *	Every edge value is computed by the same expression as tileSplit(), so both
+ *	backends emit the same quads with the same barycentric coordinates, in the
+ *	same order.
+ */
+
+#include "gpu_core.h"
+#include "simd_lane.h"
+
+/// Vertex each edge function is evaluated relative to, as in tileSplit()
+static const int scanEdgeVtx[3] = {1, 2, 0};
+
+void GPU_Core::tileScan(tileWorker &tw, int x, int y, int startLevel)
+{
+	const triangle &tri = *tw.tri;
+	int i, j, k, lc, level;
+
+/*
+ * A level holds at most every quad of the start tile, plus lane padding. The
+ * lists live in the tile worker and only grow when a higher start level shows
+ * up.
+ */
+	const int nodeMax = (1<<(2*startLevel)) + SHADER_SOA_WIDTH;
+	if ((int)tw.scanNode.size() < 12*nodeMax) {
+		tw.scanNode.resize(12*nodeMax);
+		tw.scanLane.resize(14*nodeMax);
+	}
+	int *curX = &tw.scanNode[0], *curY = &tw.scanNode[nodeMax];
+	int *nextX = &tw.scanNode[2*nodeMax], *nextY = &tw.scanNode[3*nodeMax];
+	int *curAcc = &tw.scanNode[4*nodeMax]; ///< Inside a trivially accepted tile
+	int *nextAcc = &tw.scanNode[5*nodeMax];
+	int *evalIdx = &tw.scanNode[6*nodeMax]; ///< Alive tiles which still need edge tests
+	int *zoneBits = &tw.scanNode[7*nodeMax]; ///< Bit q set if child q may be covered
+	int *insideBits[4] = { ///< Pixel coverage of the quads, one word per lane group
+		&tw.scanNode[8*nodeMax], &tw.scanNode[9*nodeMax],
+		&tw.scanNode[10*nodeMax], &tw.scanNode[11*nodeMax] };
+	float *ctrX = &tw.scanLane[0], *ctrY = &tw.scanLane[nodeMax];
+	int curCnt = 1, nextCnt, aliveCnt = 0, evalCnt;
+
+	curX[0] = x;
+	curY[0] = y;
+	curAcc[0] = false;
+
+	for (level=startLevel; level>=0; level--) {
+		const int s = 1<<level;
+
+/*
+ * Drop tiles hidden by hierarchical Z or owned by another worker, then lay
+ * out the centers of the tiles still to be tested. Tiles inside a trivially
+ * accepted tile are neither counted nor tested, as tileSplit() never visits
+ * them. A tile above START_SPLIT_LEVEL is counted by the owner of its first
+ * screen tile only.
+ */
+		aliveCnt = evalCnt = 0;
+		for (i=0; i<curCnt; i++) {
+			if (!curAcc[i]) {
+				if (level == START_SPLIT_LEVEL && !OwnTile(tw, curX[i], curY[i]))
+					continue;
+				if (level <= START_SPLIT_LEVEL || OwnTile(tw, curX[i], curY[i]))
+					tw.tileSplitCnt[level]++;
+				if (hiZ && HiZReject(tw, curX[i], curY[i], level))
+					continue;
+				ctrX[evalCnt] = curX[i] + s;
+				ctrY[evalCnt] = curY[i] + s;
+				evalIdx[evalCnt++] = aliveCnt;
+			}
+			curX[aliveCnt] = curX[i];
+			curY[aliveCnt] = curY[i];
+			curAcc[aliveCnt] = curAcc[i];
+			aliveCnt++;
+		}
+		if (aliveCnt == 0)
+			return;
+
+		if (level == 0)
+			break;
+		for (i=evalCnt; i%SHADER_SOA_WIDTH; i++) {
+			ctrX[i] = ctrX[0];
+			ctrY[i] = ctrY[0];
+		}
+
+/*
+ * Corner offsets of tileSplit():
+ *    5 6 7
+ *    3 c 4
+ *    0 1 2
+ */
+		float cornerOfs[3][8];
+		for (lc=0; lc<3; lc++) {
+			cornerOfs[lc][0] = (-tri.Edge[lc][0]+tri.Edge[lc][1])*s;
+			cornerOfs[lc][1] = (            +tri.Edge[lc][1])*s;
+			cornerOfs[lc][2] = ( tri.Edge[lc][0]+tri.Edge[lc][1])*s;
+			cornerOfs[lc][3] = (-tri.Edge[lc][0]            )*s;
+			cornerOfs[lc][4] = ( tri.Edge[lc][0]            )*s;
+			cornerOfs[lc][5] = (-tri.Edge[lc][0]-tri.Edge[lc][1])*s;
+			cornerOfs[lc][6] = (            -tri.Edge[lc][1])*s;
+			cornerOfs[lc][7] = ( tri.Edge[lc][0]-tri.Edge[lc][1])*s;
+		}
+
+		for (i=0; i<evalCnt; i+=SHADER_SOA_WIDTH) {
+			lanef cx = laneLoad(ctrX+i), cy = laneLoad(ctrY+i);
+			lanef zero = laneSet(0.0f);
+			int zone[4] = {~0, ~0, ~0, ~0};
+			int accept = ~0;
+
+			for (lc=0; lc<3; lc++) {
+				const floatVec4 &v = tri.v[scanEdgeVtx[lc]].attr[0];
+				lanef c = laneSub(laneMul(laneSub(cx, laneSet(v.x)), laneSet(tri.Edge[lc][0])),
+								  laneMul(laneSub(cy, laneSet(v.y)), laneSet(tri.Edge[lc][1])));
+				int ge[8], geC = laneBits(laneGe(c, zero));
+
+				for (k=0; k<8; k++)
+					ge[k] = laneBits(laneGe(laneAdd(c, laneSet(cornerOfs[lc][k])), zero));
+
+				zone[0] &= ge[0] | ge[1] | ge[3] | geC;
+				zone[1] &= ge[1] | ge[2] | geC | ge[4];
+				zone[2] &= ge[3] | geC | ge[5] | ge[6];
+				zone[3] &= geC | ge[4] | ge[6] | ge[7];
+				accept &= ge[0] & ge[2] & ge[5] & ge[7];
+			}
+
+			for (j=0; j<SHADER_SOA_WIDTH && i+j<evalCnt; j++) {
+				int n = evalIdx[i+j];
+				zoneBits[n] = ((zone[0]>>j) & 1) | (((zone[1]>>j) & 1) << 1) |
+							  (((zone[2]>>j) & 1) << 2) | (((zone[3]>>j) & 1) << 3);
+				if (level <= START_SPLIT_LEVEL && ((accept>>j) & 1)) {
+					tw.trivialAcceptTile[level]++;
+					curAcc[n] = true;
+				}
+			}
+		}
+
+		// Children are appended in tileSplit()'s visiting order.
+		nextCnt = 0;
+		for (i=0; i<aliveCnt; i++) {
+			int px = curX[i], py = curY[i];
+			int zone = curAcc[i]? 0xf : zoneBits[i];
+			bool inX = (px + s) <= tri.RX, inY = (py + s) <= tri.HY;
+
+			if (zone & 1) {
+				nextX[nextCnt] = px;	nextY[nextCnt] = py;	nextAcc[nextCnt++] = curAcc[i];
+			}
+			if ((zone & 2) && inX) {
+				nextX[nextCnt] = px+s;	nextY[nextCnt] = py;	nextAcc[nextCnt++] = curAcc[i];
+			}
+			if ((zone & 4) && inY) {
+				nextX[nextCnt] = px;	nextY[nextCnt] = py+s;	nextAcc[nextCnt++] = curAcc[i];
+			}
+			if ((zone & 8) && inX && inY) {
+				nextX[nextCnt] = px+s;	nextY[nextCnt] = py+s;	nextAcc[nextCnt++] = curAcc[i];
+			}
+		}
+
+		if (nextCnt == 0)
+			return;
+		std::swap(curX, nextX);
+		std::swap(curY, nextY);
+		std::swap(curAcc, nextAcc);
+		curCnt = nextCnt;
+	}
+
+	// Level 0, curX/curY hold the 2x2 quads. Every quad is tested for coverage.
+	for (i=0; i<aliveCnt; i++) {
+		ctrX[i] = curX[i] + 1;
+		ctrY[i] = curY[i] + 1;
+	}
+	for (i=aliveCnt; i%SHADER_SOA_WIDTH; i++) {
+		ctrX[i] = ctrX[0];
+		ctrY[i] = ctrY[0];
+	}
+	float pixOfs[3][4];
+	for (lc=0; lc<3; lc++) {
+		pixOfs[lc][0] = (-tri.Edge[lc][0]+tri.Edge[lc][1])*0.5;
+		pixOfs[lc][1] = ( tri.Edge[lc][0]+tri.Edge[lc][1])*0.5;
+		pixOfs[lc][2] = (-tri.Edge[lc][0]-tri.Edge[lc][1])*0.5;
+		pixOfs[lc][3] = ( tri.Edge[lc][0]-tri.Edge[lc][1])*0.5;
+	}
+
+	// Edge lc at pixel k of quad i is pixTestL[(k*3+lc)*nodeMax + i]
+	float *pixTestL = &tw.scanLane[2*nodeMax];
+
+	for (i=0; i<aliveCnt; i+=SHADER_SOA_WIDTH) {
+		lanef cx = laneLoad(ctrX+i), cy = laneLoad(ctrY+i);
+		lanef zero = laneSet(0.0f);
+		int *inside[4];
+		for (k=0; k<4; k++) {
+			inside[k] = &insideBits[k][i/SHADER_SOA_WIDTH];
+			*inside[k] = ~0;
+		}
+
+		for (lc=0; lc<3; lc++) {
+			const floatVec4 &v = tri.v[scanEdgeVtx[lc]].attr[0];
+			lanef c = laneSub(laneMul(laneSub(cx, laneSet(v.x)), laneSet(tri.Edge[lc][0])),
+							  laneMul(laneSub(cy, laneSet(v.y)), laneSet(tri.Edge[lc][1])));
+
+			for (k=0; k<4; k++) {
+				lanef t = laneAdd(c, laneSet(pixOfs[lc][k]));
+				laneStore(pixTestL + (k*3+lc)*nodeMax + i, t);
+				*inside[k] &= laneBits(laneGe(t, zero));
+			}
+		}
+	}
+
+	for (i=0; i<aliveCnt; i++) {
+		int coverMask = 0;
+		for (k=0; k<4; k++)
+			coverMask |= ((insideBits[k][i/SHADER_SOA_WIDTH] >> (i%SHADER_SOA_WIDTH)) & 1) << k;
+		if (coverMask == 0)
+			continue;
+
+		float pixTest[4][3];
+		for (k=0; k<4; k++)
+			for (lc=0; lc<3; lc++)
+				pixTest[k][lc] = pixTestL[(k*3+lc)*nodeMax + i];
+		EmitQuad(tw, curX[i], curY[i], pixTest, coverMask);
+	}
+}
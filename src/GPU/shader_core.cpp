@@ -20,36 +20,81 @@
  *  @author Liou Jhe-Yu(lioujheyu@gmail.com)
  */
 
+#include <algorithm>
+#include <vector>
+
 #include "shader_core.h"
 
 void ShaderCore::Init()
 {
 	PC = 0;
+	laneMask = false;
 	for (int i=0; i<SHADER_EXECUNIT; i++) {
 		isEnable[i] = false;
+		isHelper[i] = false;
 		curCCState[i] = true;
 	}
 }
 
+/**
+ *	Classify the enabled lanes. Without laneMask every enabled lane is live.
+ *	Otherwise ghost and killed lanes become helpers, and all lanes of a quad
+ *	without a live lane become idle. It is run again after each KIL, so lanes
+ *	only move down.
+ */
+void ShaderCore::SetupLane()
+{
+	int i, q;
+	bool live;
+
+	for (i=0; i<SHADER_EXECUNIT; i++) {
+		laneClass[i] = (laneMask && (isHelper[i] || thread[i].isKilled))?
+					   LANE_HELPER : LANE_LIVE;
+	}
+
+	if (!laneMask)
+		return;
+
+	for (q=0; q<SHADER_EXECUNIT; q+=4) {
+		live = false;
+		for (i=q; i<q+4; i++)
+			live = live || (isEnable[i] && laneClass[i] == LANE_LIVE);
+		if (!live) {
+			for (i=q; i<q+4; i++)
+				laneClass[i] = LANE_IDLE;
+		}
+	}
+}
+
 void ShaderCore::Run()
 {
 	int i;
+	laneExecFunc exec;
+
+	if (engine != SHADER_ENGINE_AOS) {
+		RunSoA();
+		return;
+	}
 
 	for (i=0; i<SHADER_EXECUNIT; i++) {
 		if (isEnable[i]) {
 			thread[i] = *threadPtr[i];
 		}
 	}
+	SetupLane();
 
 	while(PC < instCnt) {
 		curInst = instPool[PC];
+		curDec = &decPool[PC];
+		exec = curDec->exec;
 
 		texID = curInst.tid;
 		texType = curInst.tType;
 /* Each pipeline needs to fetch data before other pipeline write result
  * back when they are in the same instruction. It avoids the barrier-
  * like instruction(DDX, DDY, TEX with auto scale factor computation)'s
- * result is corrupted.
+ * result is corrupted. Helper lanes fetch even if they skip the instruction,
+ * their sources are what the live lanes take the difference with.
  */
 		for (i=0; i<SHADER_EXECUNIT; i++) {
 			if (isEnable[i])
@@ -58,14 +103,22 @@ void ShaderCore::Run()
 
 		for (i=0; i<SHADER_EXECUNIT; i++) {
 			if (isEnable[i]){
-				Exec(i);
+				if (!LaneRuns(i)) {
+					helperSkipCnt += (curCCState[i])? 1 : 0;
+					continue;
+				}
+				(this->*exec)(i);
 				if (curCCState[i] == true) {
 					totalInstructionCnt+=1;
+					helperInstructionCnt += (laneClass[i] != LANE_LIVE)? 1 : 0;
 					WriteBack(i);
 				}
 			}
 		}
 
+		if (laneMask && curInst.op == OP_KIL)
+			SetupLane();
+
 		PC++;
 	}
 
@@ -75,13 +128,19 @@ void ShaderCore::Run()
 	}
 }
 
-///@todo Separate vector operation into scalar operation.
+/**
+ *	Execute opcode @a op for lane @a idx. Each opcode has its own instance, so
+ *	the switch is resolved at compile time.
+ *
+ *	@todo Separate vector operation into scalar operation.
+ */
+template <int op>
 void ShaderCore::Exec(int idx)
 {
 	floatVec4 scaleFacDX, scaleFacDY;
 	int baseIdx = (idx>>2)<<2;
 
-	switch (curInst.op) {
+	switch (op) {
 	//VECTORop
 	case OP_ABS:
 		dst[idx] = fvabs(src[idx][0]);
@@ -380,19 +439,19 @@ void ShaderCore::Exec(int idx)
 	case OP_KIL:
 		switch (curInst.src[0].ccMask) {
 		case CC_EQ: case CC_EQ0: case CC_EQ1:
-			thread[idx].isKilled = curCCState[idx] &&
+			thread[idx].isKilled = thread[idx].isKilled || (curCCState[idx] &&
 				( (!(src[idx][0].x == 1.0) && (src[idx][1].x == 1.0)) ||
 				  (!(src[idx][0].y == 1.0) && (src[idx][1].y == 1.0)) ||
 				  (!(src[idx][0].z == 1.0) && (src[idx][1].z == 1.0)) ||
-				  (!(src[idx][0].w == 1.0) && (src[idx][1].w == 1.0)) );
+				  (!(src[idx][0].w == 1.0) && (src[idx][1].w == 1.0)) ));
 			break;
 
 		case CC_NE: case CC_NE0: case CC_NE1:
-			thread[idx].isKilled = curCCState[idx] &&
+			thread[idx].isKilled = thread[idx].isKilled || (curCCState[idx] &&
 				( ((src[idx][0].x == 1.0) || !(src[idx][1].x == 1.0)) ||
 				  ((src[idx][0].y == 1.0) || !(src[idx][1].y == 1.0)) ||
 				  ((src[idx][0].z == 1.0) || !(src[idx][1].z == 1.0)) ||
-				  ((src[idx][0].w == 1.0) || !(src[idx][1].w == 1.0)) );
+				  ((src[idx][0].w == 1.0) || !(src[idx][1].w == 1.0)) ));
 			break;
 
 		default:
@@ -403,16 +462,16 @@ void ShaderCore::Exec(int idx)
 		break;
 	//DERIVEop
 	case OP_DDX:
-		if (idx==0 || idx==2)
+		if ((idx%4)==0 || (idx%4)==2)
 			dst[idx] = src[idx+1][0] - src[idx][0];
-		else // idx==1 || idx==3
+		else // (idx%4)==1 || (idx%4)==3
 			dst[idx] = src[idx][0] - src[idx-1][0];
 		break;
 
 	case OP_DDY:
-		if (idx==0 || idx==1)
+		if ((idx%4)==0 || (idx%4)==1)
 			dst[idx] = src[idx+2][0] - src[idx][0];
-		else // idx==2 || idx==3
+		else // (idx%4)==2 || (idx%4)==3
 			dst[idx] = src[idx][0] - src[idx-2][0];
 		break;
 
@@ -423,37 +482,86 @@ void ShaderCore::Exec(int idx)
 	}
 }
 
+laneExecFunc ShaderCore::LaneExec(int op)
+{
+#define LANE_EXEC(OP) case OP: return &ShaderCore::Exec<OP>
+
+	switch (op) {
+	LANE_EXEC(OP_ABS); LANE_EXEC(OP_CEIL); LANE_EXEC(OP_FLR);
+	LANE_EXEC(OP_FRC); LANE_EXEC(OP_I2F); LANE_EXEC(OP_MOV);
+	LANE_EXEC(OP_ROUND); LANE_EXEC(OP_TRUNC); LANE_EXEC(OP_RCP);
+	LANE_EXEC(OP_ADD); LANE_EXEC(OP_AND); LANE_EXEC(OP_DIV);
+	LANE_EXEC(OP_DP2); LANE_EXEC(OP_DP3); LANE_EXEC(OP_DP4);
+	LANE_EXEC(OP_DST); LANE_EXEC(OP_MAX); LANE_EXEC(OP_MIN);
+	LANE_EXEC(OP_MUL); LANE_EXEC(OP_RSQ); LANE_EXEC(OP_SEQ);
+	LANE_EXEC(OP_SGE); LANE_EXEC(OP_SGT); LANE_EXEC(OP_SLE);
+	LANE_EXEC(OP_SLT); LANE_EXEC(OP_SNE); LANE_EXEC(OP_SUB);
+	LANE_EXEC(OP_DP2A); LANE_EXEC(OP_MAD); LANE_EXEC(OP_TEX);
+	LANE_EXEC(OP_TXF); LANE_EXEC(OP_TXL); LANE_EXEC(OP_TXD);
+	LANE_EXEC(OP_ENDREP); LANE_EXEC(OP_IF); LANE_EXEC(OP_REP);
+	LANE_EXEC(OP_ELSE); LANE_EXEC(OP_ENDIF); LANE_EXEC(OP_POW);
+	LANE_EXEC(OP_KIL); LANE_EXEC(OP_DDX); LANE_EXEC(OP_DDY);
+	default:
+		// Falls to the "unimplemented" report of Exec().
+		return &ShaderCore::Exec<OP_END>;
+	}
+
+#undef LANE_EXEC
+}
+
+/// @name Operand swizzles
+/// One function per _mm_shuffle_ps immediate, DecodeProgram() picks the one
+/// of each operand so fetching it costs a single shuffle.
+///@{
+template <int imm>
+static floatVec4 SwizzleImm(const floatVec4 &in)
+{
+#ifdef USE_SSE
+	return _mm_shuffle_ps(in.sse, in.sse, imm);
+#else
+	return floatVec4(Component(in, imm&3), Component(in, (imm>>2)&3),
+					 Component(in, (imm>>4)&3), Component(in, (imm>>6)&3));
+#endif
+}
+
+#define SWIZZLE4(i)		SwizzleImm<i>, SwizzleImm<i+1>, SwizzleImm<i+2>, SwizzleImm<i+3>
+#define SWIZZLE16(i)	SWIZZLE4(i), SWIZZLE4(i+4), SWIZZLE4(i+8), SWIZZLE4(i+12)
+#define SWIZZLE64(i)	SWIZZLE16(i), SWIZZLE16(i+16), SWIZZLE16(i+32), SWIZZLE16(i+48)
+static const swizzleFunc swizzleTable[256] = {
+	SWIZZLE64(0), SWIZZLE64(64), SWIZZLE64(128), SWIZZLE64(192)
+};
+#undef SWIZZLE64
+#undef SWIZZLE16
+#undef SWIZZLE4
+
+/// Select the components of @a in by the operand's swizzle.
+static inline floatVec4 Swizzle(const floatVec4 &in, const decodedOperand &opnd)
+{
+	return (opnd.swizzle == nullptr)? in : opnd.swizzle(in);
+}
+///@}
+
 void ShaderCore::FetchData(int idx)
 {
-	for (int i=0; i<3; i++) {
-		switch (curInst.src[i].type) {
-		case INST_NO_TYPE:
-			return;
-		case INST_ATTRIB:
-			src[idx][i] = ReadByMask(thread[idx].attr[curInst.src[i].id],
-									 curInst.src[i].modifier );
-			break;
+	for (int i=0; i<curDec->srcCnt; i++) {
+		const decodedOperand &opnd = curDec->src[i];
 
-		case INST_UNIFORM:
-			src[idx][i] = ReadByMask(uniformPool[curInst.src[i].id],
-									 curInst.src[i].modifier );
+		switch (opnd.type) {
+		case INST_ATTRIB:
+			src[idx][i] = Swizzle(thread[idx].attr[opnd.id], opnd);
 			break;
 
 		case INST_REG:
-			src[idx][i] = ReadByMask(reg[curInst.src[i].id*SHADER_EXECUNIT + idx],
-									 curInst.src[i].modifier );
+			src[idx][i] = Swizzle(reg[opnd.id*SHADER_EXECUNIT + idx], opnd);
 			break;
 
 		case INST_CCREG:
-			src[idx][0] = ReadByMask(CCisSigned[idx][curInst.src[i].id],
-									 curInst.src[i].ccModifier );
-			src[idx][1] = ReadByMask(CCisZero[idx][curInst.src[i].id],
-									 curInst.src[i].ccModifier);
+			src[idx][0] = Swizzle(CCisSigned[idx][opnd.id], opnd);
+			src[idx][1] = Swizzle(CCisZero[idx][opnd.id], opnd);
 			break;
 
 		case INST_CONSTANT:
-			src[idx][i] = ReadByMask(curInst.src[i].val,
-									 curInst.src[i].modifier);
+			src[idx][i] = opnd.val;
 			break;
 
 		default:
@@ -462,36 +570,57 @@ void ShaderCore::FetchData(int idx)
 			return;
 		}
 
-		if (curInst.src[i].inverse) {
+		if (opnd.inverse) {
 			src[idx][i].x = -src[idx][i].x;
 			src[idx][i].y = -src[idx][i].y;
 			src[idx][i].z = -src[idx][i].z;
 			src[idx][i].w = -src[idx][i].w;
 		}
 
-		if (curInst.src[i].abs)
+		if (opnd.abs)
 			src[idx][i] = fvabs(src[idx][i]);
 	}
 }
 
 void ShaderCore::WriteBack(int idx)
 {
-	switch (curInst.dst.type) {
+	floatVec4 *fvdst;
+	float val;
+	int c;
+
+	switch (curDec->dstType) {
 	case INST_ATTRIB:
-		WriteByMask(dst[idx], &(threadPtr[idx]->attr[curInst.dst.id]), curInst.dst.modifier, idx);
+		fvdst = &(threadPtr[idx]->attr[curDec->dstID]);
 		break;
 
 	case INST_REG:
-		if (curInst.dst.id < 0)
-			WriteByMask(dst[idx], nullptr, curInst.dst.modifier, idx);
-		else
-			WriteByMask(dst[idx], &(reg[curInst.dst.id*SHADER_EXECUNIT + idx]), curInst.dst.modifier, idx);
+		fvdst = (curDec->dstID < 0)? nullptr :
+				&(reg[curDec->dstID*SHADER_EXECUNIT + idx]);
 		break;
 
-	case INST_COLOR:
-		WriteByMask(dst[idx], &(threadPtr[idx]->attr[1]), curInst.dst.modifier, idx);
-		break;
+	default:
+		return;
 	}
+
+	for (int i=0; i<curDec->writeCnt; i++) {
+		c = curDec->writeComp[i];
+		val = Component(dst[idx], c);
+
+		if (fvdst != nullptr) {
+			if (curDec->satMode == 1)
+				Component(*fvdst, c) = CLAMP(val, 0.0f, 1.0f);
+			else if (curDec->satMode == 2)
+				Component(*fvdst, c) = CLAMP(val, -1.0f, 1.0f);
+			else
+				Component(*fvdst, c) = val;
+		}
+
+		if (curDec->ccID >= 0) {
+			Component(CCisSigned[idx][curDec->ccID], c) = (val < 0)?1.0:0.0;
+			Component(CCisZero[idx][curDec->ccID], c) = (val == 0)?1.0:0.0;
+		}
+	}
+	totalScaleOperation += curDec->writeCnt;
 }
 
 floatVec4 ShaderCore::ReadByMask(const floatVec4 &in, int mask)
@@ -538,92 +667,301 @@ floatVec4 ShaderCore::ReadByMask(const floatVec4 &in, int mask)
 	return temp;
 }
 
-void ShaderCore::WriteByMask(const floatVec4 &val, floatVec4* fvdst, int mask, int idx)
+/**
+ *	Translate the source component mask into the component index of each
+ *	output component, the same selection as ShaderCore::ReadByMask().
+ */
+static void MaskToComponent(int mask, int comp[4])
 {
 	for (int i=0; i<4; i++) {
-		if ( ((mask>>i*4)&0xf) == 0x1 ) { // x | r
-			if (fvdst != nullptr) {
-				if(curInst.opModifiers[OPM_SAT])
-					fvdst->x = CLAMP(val.x, 0.0f, 1.0f);
-				else if(curInst.opModifiers[OPM_SSAT])
-					fvdst->x = CLAMP(val.x, -1.0f, 1.0f);
-				else
-					fvdst->x = val.x;
-			}
+		int n = (mask >> (i*4)) & 0xf;
 
-			if (curInst.opModifiers[OPM_CC] || curInst.opModifiers[OPM_CC0]) {
-				CCisSigned[idx][0].x = (val.x < 0)?1.0:0.0;
-				CCisZero[idx][0].x = (val.x == 0)?1.0:0.0;
-			}
-			else if (curInst.opModifiers[OPM_CC1]) {
-				CCisSigned[idx][1].x = (val.x < 0)?1.0:0.0;
-				CCisZero[idx][1].x = (val.x == 0)?1.0:0.0;
+		if (i > 0 && n == 0)
+			comp[i] = comp[i-1];
+		else
+			comp[i] = (n == 0x1)? 0: (n == 0x2)? 1: (n == 0x4)? 2: 3;
+	}
+}
+
+void DecodeProgram(const instruction *inst, int instCnt,
+				   const floatVec4 *uniformPool, decodedInst *out)
+{
+	int i, n, c;
+
+	for (int pc=0; pc<instCnt; pc++) {
+		const instruction &in = inst[pc];
+		decodedInst &dec = out[pc];
+
+		dec.srcCnt = 0;
+		for (i=0; i<3; i++) {
+			const operand &opnd = in.src[i];
+			decodedOperand &dOpnd = dec.src[i];
+
+			if (opnd.type == INST_NO_TYPE)
+				break;
+
+			dOpnd.type = opnd.type;
+			dOpnd.id = opnd.id;
+			dOpnd.inverse = opnd.inverse;
+			dOpnd.abs = opnd.abs;
+			MaskToComponent((opnd.type == INST_CCREG)? opnd.ccModifier :
+													   opnd.modifier,
+							dOpnd.comp);
+			c = dOpnd.comp[0] | dOpnd.comp[1]<<2 | dOpnd.comp[2]<<4 | dOpnd.comp[3]<<6;
+			dOpnd.swizzle = (c == 0xe4)? nullptr : swizzleTable[c];
+
+			if (opnd.type == INST_UNIFORM || opnd.type == INST_CONSTANT) {
+				dOpnd.val = ShaderCore::ReadByMask(
+								(opnd.type == INST_UNIFORM)?
+								uniformPool[opnd.id] : opnd.val,
+								opnd.modifier );
+				if (opnd.inverse) {
+					dOpnd.val.x = -dOpnd.val.x;
+					dOpnd.val.y = -dOpnd.val.y;
+					dOpnd.val.z = -dOpnd.val.z;
+					dOpnd.val.w = -dOpnd.val.w;
+				}
+				if (opnd.abs)
+					dOpnd.val = fvabs(dOpnd.val);
+
+				dOpnd.type = INST_CONSTANT;
+				dOpnd.inverse = dOpnd.abs = false;
 			}
-			totalScaleOperation+=1;
+
+			dec.srcCnt++;
 		}
-		else if ( ((mask>>i*4)&0xf) == 0x2) { // y | g
-			if (fvdst != nullptr) {
-				if(curInst.opModifiers[OPM_SAT])
-					fvdst->y = CLAMP(val.y, 0.0f, 1.0f);
-				else if(curInst.opModifiers[OPM_SSAT])
-					fvdst->y = CLAMP(val.y, -1.0f, 1.0f);
-				else
-					fvdst->y = val.y;
-			}
 
-			if (curInst.opModifiers[OPM_CC] || curInst.opModifiers[OPM_CC0]) {
-				CCisSigned[idx][0].y = (val.y < 0)?1.0:0.0;
-				CCisZero[idx][0].y = (val.y == 0)?1.0:0.0;
-			}
-			else if (curInst.opModifiers[OPM_CC1]) {
-				CCisSigned[idx][1].y = (val.y < 0)?1.0:0.0;
-				CCisZero[idx][1].y = (val.y == 0)?1.0:0.0;
-			}
-			totalScaleOperation+=1;
+		dec.dstID = in.dst.id;
+		switch (in.dst.type) {
+		case INST_ATTRIB:
+		case INST_REG:
+			dec.dstType = in.dst.type;
+			break;
+
+		case INST_COLOR:
+			dec.dstType = INST_ATTRIB;
+			dec.dstID = 1;
+			break;
+
+		default:
+			dec.dstType = INST_NO_TYPE;
+			break;
 		}
-		else if ( ((mask>>i*4)&0xf) == 0x4) { // z | b
-			if (fvdst != nullptr)	{
-				if(curInst.opModifiers[OPM_SAT])
-					fvdst->z = CLAMP(val.z, 0.0f, 1.0f);
-				else if(curInst.opModifiers[OPM_SSAT])
-					fvdst->z = CLAMP(val.z, -1.0f, 1.0f);
-				else
-					fvdst->z = val.z;
-			}
 
-			if (curInst.opModifiers[OPM_CC] || curInst.opModifiers[OPM_CC0]) {
-				CCisSigned[idx][0].z = (val.z < 0)?1.0:0.0;
-				CCisZero[idx][0].z = (val.z == 0)?1.0:0.0;
-			}
-			else if (curInst.opModifiers[OPM_CC1]) {
-				CCisSigned[idx][1].z = (val.z < 0)?1.0:0.0;
-				CCisZero[idx][1].z = (val.z == 0)?1.0:0.0;
-			}
-			totalScaleOperation+=1;
+		dec.writeCnt = 0;
+		for (i=0; i<4; i++) {
+			n = (in.dst.modifier >> i*4) & 0xf;
+			c = (n == 0x1)? 0: (n == 0x2)? 1: (n == 0x4)? 2: (n == 0x8)? 3: -1;
+			if (c < 0)
+				break;
+			dec.writeComp[dec.writeCnt++] = c;
 		}
-		else if ( ((mask>>i*4)&0xf) == 0x8) { // w | a
-			if (fvdst != nullptr)	{
-				if(curInst.opModifiers[OPM_SAT])
-					fvdst->w = CLAMP(val.w, 0.0f, 1.0f);
-				else if(curInst.opModifiers[OPM_SSAT])
-					fvdst->w = CLAMP(val.w, -1.0f, 1.0f);
-				else
-					fvdst->w = val.w;
+
+		dec.satMode = (in.opModifiers[OPM_SAT])? 1:
+					  (in.opModifiers[OPM_SSAT])? 2: 0;
+
+		if (in.opModifiers[OPM_CC] || in.opModifiers[OPM_CC0])
+			dec.ccID = 0;
+		else if (in.opModifiers[OPM_CC1])
+			dec.ccID = 1;
+		else
+			dec.ccID = -1;
+
+		dec.runLane = LANE_IDLE;
+		dec.exec = ShaderCore::LaneExec(in.op);
+		dec.execSoA = ShaderCore::SoAExec(in.op);
+	}
+}
+
+/**
+ *	Raise the lane class which needs each register read by @a in to at least
+ *	@a lane.
+ *
+ *	@return True if anything is raised.
+ */
+static bool NeedSource(const instruction &in, int lane, int needReg[], int needCC[])
+{
+	bool changed = false;
+	int *need;
+
+	for (int i=0; i<3; i++) {
+		const operand &opnd = in.src[i];
+
+		if (opnd.type == INST_REG && opnd.id >= 0)
+			need = &needReg[opnd.id];
+		else if (opnd.type == INST_CCREG)
+			need = &needCC[opnd.id];
+		else
+			continue;
+
+		if (*need < lane) {
+			*need = lane;
+			changed = true;
+		}
+	}
+	return changed;
+}
+
+void HelperLaneAnalysis(const instruction *inst, int instCnt, int *runLane)
+{
+	int needReg[MAX_SHADER_REG_VECTOR], needCC[2] = {LANE_LIVE, LANE_LIVE};
+	std::vector<int> blockEnd(instCnt, instCnt);
+	std::stack<int> ifPC;
+	bool changed = true;
+	int pc, i, cc, lane;
+
+	for (i=0; i<MAX_SHADER_REG_VECTOR; i++)
+		needReg[i] = LANE_LIVE;
+	for (pc=0; pc<instCnt; pc++) {
+		runLane[pc] = LANE_LIVE;
+		if (inst[pc].op == OP_IF)
+			ifPC.push(pc);
+		else if (inst[pc].op == OP_ENDIF && !ifPC.empty()) {
+			blockEnd[ifPC.top()] = pc;
+			ifPC.pop();
+		}
+	}
+
+/*
+ * needReg and needCC hold the highest lane class which may read the register
+ * later. Writes are never treated as killing the value, as write masks and
+ * branches make them partial. The pass is repeated until REP loops settle.
+ */
+	while (changed) {
+		changed = false;
+
+		for (pc=instCnt-1; pc>=0; pc--) {
+			const instruction &in = inst[pc];
+
+			switch (in.op) {
+			// A lane only needs its branch condition if it runs something in the block.
+			case OP_IF:
+				runLane[pc] = LANE_IDLE;
+				lane = LANE_LIVE;
+				for (i=pc+1; i<blockEnd[pc]; i++) {
+					if (runLane[i] != LANE_IDLE)
+						lane = std::max(lane, runLane[i]);
+				}
+				changed = NeedSource(in, lane, needReg, needCC) || changed;
+				continue;
+
+			// Lane 0 drives the loops of the whole batch, even if it is idle.
+			case OP_REP:
+				runLane[pc] = LANE_IDLE;
+				changed = NeedSource(in, LANE_IDLE, needReg, needCC) || changed;
+				continue;
+
+			case OP_ELSE: case OP_ENDIF: case OP_ENDREP:
+				runLane[pc] = LANE_IDLE;
+				continue;
+
+			case OP_DDX: case OP_DDY:
+			case OP_TEX: case OP_TXB: case OP_TXP:
+				// The live lanes take the difference with this source of their helpers.
+				if (in.src[0].type == INST_REG && needReg[in.src[0].id] < LANE_HELPER) {
+					needReg[in.src[0].id] = LANE_HELPER;
+					changed = true;
+				}
+				break;
+
+			default:
+				break;
 			}
 
-			if (curInst.opModifiers[OPM_CC] || curInst.opModifiers[OPM_CC0]) {
-				CCisSigned[idx][0].w = (val.w < 0)?1.0:0.0;
-				CCisZero[idx][0].w = (val.w == 0)?1.0:0.0;
+			lane = runLane[pc];
+			if (in.dst.type == INST_REG && in.dst.id >= 0)
+				lane = std::max(lane, needReg[in.dst.id]);
+			cc = (in.opModifiers[OPM_CC] || in.opModifiers[OPM_CC0])? 0 :
+				 (in.opModifiers[OPM_CC1])? 1 : -1;
+			if (cc >= 0)
+				lane = std::max(lane, needCC[cc]);
+
+			if (lane != runLane[pc]) {
+				runLane[pc] = lane;
+				changed = true;
 			}
-			else if (curInst.opModifiers[OPM_CC1]) {
-				CCisSigned[idx][1].w = (val.w < 0)?1.0:0.0;
-				CCisZero[idx][1].w = (val.w == 0)?1.0:0.0;
+			changed = NeedSource(in, lane, needReg, needCC) || changed;
+		}
+	}
+}
+
+/// Result components written by the instruction, as a 4-bit mask
+static int WriteMask(const instruction &in)
+{
+	int n, mask = 0;
+
+	for (int i=0; i<4; i++) {
+		n = (in.dst.modifier >> i*4) & 0xf;
+		if (n != 0x1 && n != 0x2 && n != 0x4 && n != 0x8)
+			break;
+		mask |= n;
+	}
+	return mask;
+}
+
+unsigned int AttribReadMask(const instruction *inst, int instCnt)
+{
+	unsigned int mask = 0;
+	int colorWrite = 0, ifDepth = 0;
+	int used, comp[4], i, c;
+
+	for (int pc=0; pc<instCnt; pc++) {
+		const instruction &in = inst[pc];
+
+		// Operand components which reach the written result components
+		switch (in.op) {
+		case OP_ABS: case OP_CEIL: case OP_FLR: case OP_FRC: case OP_I2F:
+		case OP_MOV: case OP_ROUND: case OP_SSG: case OP_TRUNC:
+		case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MAD:
+		case OP_MAX: case OP_MIN: case OP_LRP: case OP_CMP:
+		case OP_SEQ: case OP_SGE: case OP_SGT: case OP_SLE: case OP_SLT:
+		case OP_SNE: case OP_SFL: case OP_STR:
+			used = WriteMask(in);
+			break;
+		case OP_RCP: case OP_RSQ: case OP_RCC: case OP_COS: case OP_SIN:
+		case OP_EX2: case OP_LG2: case OP_POW:
+			used = 0x1;
+			break;
+		case OP_DP2:
+			used = 0x3;
+			break;
+		case OP_DP3: case OP_XPD:
+			used = 0x7;
+			break;
+		default:
+			used = 0xf;
+			break;
+		}
+
+		for (i=0; i<3; i++) {
+			const operand &opnd = in.src[i];
+			int srcUsed = used;
+
+			if (opnd.type != INST_ATTRIB)
+				continue;
+
+			// Texture coordinates only need as many components as the target.
+			if (i == 0 && (in.op == OP_TEX || in.op == OP_TXF) &&
+				(in.tType == TT_1D || in.tType == TT_2D || in.tType == TT_RECT))
+				srcUsed = (in.tType == TT_1D)? 0x1 : 0x3;
+
+			MaskToComponent(opnd.modifier, comp);
+			for (c=0; c<4; c++) {
+				if (srcUsed & (1<<c))
+					mask |= 1u << (4*opnd.id + comp[c]);
 			}
-			totalScaleOperation+=1;
 		}
-		else // '\0'
-			return;
+
+		if (in.op == OP_IF)
+			ifDepth++;
+		else if (in.op == OP_ENDIF)
+			ifDepth--;
+		else if (ifDepth == 0 && (in.dst.type == INST_COLOR ||
+				 (in.dst.type == INST_ATTRIB && in.dst.id == 1)))
+			colorWrite |= WriteMask(in);
 	}
+
+	return mask | ((~colorWrite & 0xfu) << 4);
 }
 
 void ShaderCore::Print()
@@ -30,6 +30,7 @@
 #include "gpu_config.h"
 #include "texture_unit.h"
 #include "instruction_def.h"
+#include "simd_lane.h"
 
 #ifdef SHADER_INFO
 #	define SHADERPRINTF(fmt, ...) \
@@ -44,6 +45,149 @@
 #	define SHADER_INFO_PTR stderr
 #endif
 
+/// Access floatVec4 component by index, 0 for x and 3 for w.
+inline float & Component(floatVec4 &v, int c) { return (&v.x)[c]; }
+inline float Component(const floatVec4 &v, int c) { return (&v.x)[c]; }
+
+/// Scale operations a DP2/3/4 adds to its multiplies, per lane as in Exec()
+inline int DPScaleOperation(int op)
+{
+	return (op == OP_DP2)? 1: (op == OP_DP3)? 2: (op == OP_DP4)? 3: 0;
+}
+
+class ShaderCore;
+
+/// Swizzle of an operand, one shuffle fixed at decode time
+typedef floatVec4 (*swizzleFunc)(const floatVec4 &in);
+/// Execute one opcode for one lane, see ShaderCore::LaneExec()
+typedef void (ShaderCore::*laneExecFunc)(int idx);
+/// Execute one opcode for every lane in SoA form, see ShaderCore::SoAExec()
+typedef void (ShaderCore::*soaExecFunc)(const int *runCnt);
+
+/**
+ *	@brief Pre-decoded instruction operand
+ *
+ *	Uniform and constant operands are folded into @ref val with their swizzle
+ *	and sign modifiers applied, so they are fetched by a plain copy.
+ */
+struct decodedOperand
+{
+	int type; ///< INST_* operand type, INST_UNIFORM is folded to INST_CONSTANT
+	int id;
+	int comp[4]; ///< Source component index of each output component
+	swizzleFunc swizzle; ///< Selects comp[] from a floatVec4, nullptr for xyzw
+	bool inverse;
+	bool abs;
+	floatVec4 val; ///< Folded value of constant operand
+};
+
+/**
+ *	@brief Pre-decoded instruction
+ *
+ *	Produced by DecodeProgram() once per draw command. It holds everything
+ *	FetchData() and WriteBack() used to decode from @ref instruction for every
+ *	lane.
+ */
+struct decodedInst
+{
+	decodedOperand src[3];
+	int srcCnt; ///< Operands before the first INST_NO_TYPE
+
+	int dstType; ///< INST_NO_TYPE, INST_ATTRIB or INST_REG(id < 0 for CC only)
+	int dstID; ///< INST_COLOR is folded into attribute 1
+	int writeComp[4]; ///< Written component indices in write order
+	int writeCnt;
+	int satMode; ///< 0: none, 1: SAT [0, 1], 2: SSAT [-1, 1]
+	int ccID; ///< Updated CC register, -1 for none
+	int runLane; ///< Lanes up to this LANE_* class run it, see HelperLaneAnalysis()
+	laneExecFunc exec; ///< Handler of the opcode
+	soaExecFunc execSoA; ///< SoA handler of the opcode, nullptr to run exec lane by lane
+};
+
+/// @name Per-lane statistic of the native code, index of soaRegFile::stat
+///@{
+#define JIT_STAT_INST		0 ///< totalInstructionCnt
+#define JIT_STAT_HELPER		1 ///< helperInstructionCnt
+#define JIT_STAT_SKIP		2 ///< helperSkipCnt
+#define JIT_STAT_SCALE		3 ///< totalScaleOperation
+#define JIT_STAT_NUM		4
+///@}
+
+/**
+ *	@brief Register file of the structure-of-arrays engine
+ *
+ *	Every floatVec4 is split into 4 component arrays indexed by lane, so that
+ *	consecutive lanes of the same component can be loaded by one SIMD register.
+ */
+struct soaRegFile
+{
+	float reg[MAX_SHADER_REG_VECTOR][4][SHADER_EXECUNIT];
+	float attr[MAX_ATTRIBUTE_NUMBER][4][SHADER_EXECUNIT];
+	float CCisSigned[2][4][SHADER_EXECUNIT], CCisZero[2][4][SHADER_EXECUNIT];
+	float src[3][4][SHADER_EXECUNIT], dst[4][SHADER_EXECUNIT];
+	float writeMask[SHADER_EXECUNIT]; ///< 1.0 if the lane writes back
+
+	/// @name Lane state of the native code, see ShaderJIT. A mask is 0 or -1.
+	///@{
+	int ccState[SHADER_EXECUNIT]; ///< curCCState
+	int ccOuter[SHADER_EXECUNIT]; ///< Condition an outermost ENDIF restores
+	int ccStack[SHADER_JIT_MAX_NEST][SHADER_EXECUNIT]; ///< Pushed by each nested IF
+	int killed[SHADER_EXECUNIT];
+	int laneRun[LANE_IDLE+1][SHADER_EXECUNIT]; ///< Enabled and runs this LANE_* class
+	int helper[SHADER_EXECUNIT]; ///< Enabled but not LANE_LIVE
+	int write[SHADER_EXECUNIT]; ///< Writes back the output attribute
+	int stat[JIT_STAT_NUM][SHADER_EXECUNIT]; ///< Statistic counted per lane
+	int repCnt[SHADER_JIT_MAX_NEST], repNum[SHADER_JIT_MAX_NEST];
+	///@}
+};
+
+/**
+ *	Lower an instruction pool into decoded form.
+ *
+ *	@param inst			Instruction pool.
+ *	@param instCnt		Program length.
+ *	@param uniformPool	Uniform values which are folded into the operands.
+ *	@param out			Receives instCnt decoded instructions.
+ */
+void DecodeProgram(const instruction *inst, int instCnt,
+				   const floatVec4 *uniformPool, decodedInst *out);
+
+/**
+ *	Find which lanes have to run each instruction of a fragment program.
+ *
+ *	Helper lanes only exist to provide DDX/DDY and the texture scale factor to
+ *	the live lanes of their quad. A backward dataflow pass marks the
+ *	instructions whose results can reach the source of such an instruction,
+ *	those are the only ones helper lanes run. Flow control is run by every
+ *	lane to keep the branch stacks balanced, but an IF condition is only
+ *	computed by the lanes which run something in its block.
+ *
+ *	@param inst		Instruction pool.
+ *	@param instCnt	Program length.
+ *	@param runLane	Receives instCnt LANE_* classes, LANE_LIVE for instructions
+ *					which only live lanes run. DecodeProgram() sets LANE_IDLE.
+ */
+void HelperLaneAnalysis(const instruction *inst, int instCnt, int *runLane);
+
+#if MAX_ATTRIBUTE_NUMBER > 8
+#	error "AttribReadMask() packs 4 bits per attribute into 32 bits"
+#endif
+
+/**
+ *	Find the attribute components a fragment program depends on, so the
+ *	rasterizer only interpolates those.
+ *
+ *	A component is needed if an instruction reads it for a result component
+ *	it writes. Components of the color output (attribute 1) which are not
+ *	always written are needed too, as they pass the interpolated value
+ *	through.
+ *
+ *	@return Bit 4*a+c is set if component c of attribute a is needed.
+ */
+unsigned int AttribReadMask(const instruction *inst, int instCnt);
+
+class ShaderJIT;
+
 /**
  *	@brief Unified shader core class
  *
@@ -52,22 +196,28 @@
  *	and write-back units in one shader core. Such architecture is served for one
  *	purpose - Find partial differential value from adjacent thread. It also has
  *	the ability to get texture scale factor without fixing hardware pipeline's
- *	help. But have a defect that it wastes resource on the ghost pixels which
- *	is already known as fail on edge test.
+ *	help. Ghost pixels, which already failed the edge test, still occupy their
+ *	lanes, but with laneMask set they only run what their quad needs from them.
  */
 class ShaderCore {
 public:
-	ShaderCore(DRAM *dram) : texUnit(dram)
+	ShaderCore(DRAM *dram)
 	{
 		this->dram = dram;
 
 		instCnt = 0;
 		totalInstructionCnt = 0;
 		totalScaleOperation = 0;
+		vertexBatchCnt = fragmentBatchCnt = 0;
+		engine = DEFAULT_SHADER_ENGINE;
 
 		texID = -1; texType = 0;
 		instPool = nullptr;
+		decPool = nullptr;
+		jit = nullptr;
+		jitConst = nullptr;
 		uniformPool = nullptr;
+		helperInstructionCnt = helperSkipCnt = 0;
 		for (int i=0; i<SHADER_EXECUNIT; i++)
 			threadPtr[i] = nullptr;
 		curInst.Init();
@@ -77,25 +227,62 @@ public:
 	TextureUnit texUnit;
 
 	bool isEnable[SHADER_EXECUNIT];
+	bool isHelper[SHADER_EXECUNIT]; ///< Ghost pixel, only used if laneMask is set
+	bool laneMask; ///< Let helper lanes skip the instructions they do not need
 	int instCnt; ///< Program Length
 	instruction const *instPool; ///< Instruction Pool pointer
+	decodedInst const *decPool; ///< Decoded form of instPool
+	ShaderJIT const *jit; ///< Native code of instPool, nullptr to interpret
+	float const *jitConst; ///< Constant table of jit
 	floatVec4 const *uniformPool; ///< Uniform Pool pointer
 	unitThread* threadPtr[SHADER_EXECUNIT];
+	int engine; ///< SHADER_ENGINE_AOS, SHADER_ENGINE_SOA or SHADER_ENGINE_JIT
 
 	///Statistic
 	///@{
 	FILE *SHADERINFOfp;
 	int totalInstructionCnt;
 	int totalScaleOperation;
+	int helperInstructionCnt; ///< Part of totalInstructionCnt run by helper lanes
+	int helperSkipCnt; ///< Lane instructions skipped by helper and idle lanes
+	int vertexBatchCnt; ///< Vertex batches dispatched to this core
+	int fragmentBatchCnt; ///< Fragment batches dispatched to this core
 	///@}
 
 	void Init();
 	void Run();
-	void Exec(int idx);
+	template <int op> void Exec(int idx);
 	void Print();
 	void FetchData(int idx);
 	void WriteBack(int idx);
 
+/**
+ *	Find the handler of an opcode, Exec() instantiated for it. Called by
+ *	DecodeProgram(), so Run() dispatches each instruction by one indirect
+ *	call instead of a switch per lane.
+ */
+	static laneExecFunc LaneExec(int op);
+
+	/// @name Structure-of-arrays execution engine
+	///@{
+	void RunSoA();
+	void FetchSoA();
+	template <int op> void ExecSoA(const int *runCnt);
+	/// SoA counterpart of LaneExec(), nullptr if the opcode has no SoA form.
+	static soaExecFunc SoAExec(int op);
+	void WriteBackSoA();
+	int UpdateWriteMask(int runLane, int instLen);
+	void CountRunLane(int *runCnt) const;
+	///@}
+
+	/// @name Callbacks of the native code, see ShaderJIT
+	///@{
+	static void JitInterpret(ShaderCore *core, int pc);
+	static void JitTexture(ShaderCore *core, int pc);
+	static void JitScatter(ShaderCore *core, int pc);
+	static void JitKill(ShaderCore *core, int pc);
+	///@}
+
 /**
  *	Extract the source floatVec4 's component by mask
  *
@@ -104,23 +291,15 @@ public:
  *
  *	@return A result floatVec4
  */
-	floatVec4 ReadByMask(const floatVec4 &in, int mask);
-
-/**
- *	Write the destination floatVec4's floating component by mask, including CC
- *	register's update if necessary.
- *
- *	@param val		A floatVec4 value prepared for writing.
- *	@param fvdst	The destination floatVec4 's pointer
- *	@param mask 	The component mask.
- */
-	void WriteByMask(const floatVec4 &val, floatVec4 *fvdst, int mask, int idx);
+	static floatVec4 ReadByMask(const floatVec4 &in, int mask);
 
 private:
 	int PC; ///<Program Counter
 	instruction	curInst; ///< Current Instruction
+	decodedInst const *curDec; ///< Decoded form of current instruction
 	unitThread thread[SHADER_EXECUNIT];
 	bool curCCState[SHADER_EXECUNIT]; ///< Current branch condition
+	int laneClass[SHADER_EXECUNIT]; ///< LANE_* class of each enabled lane
 	std::stack<bool> ccStack[SHADER_EXECUNIT]; ///< Branch condition stack for nest IF block
 	std::stack<int> RepCntStack; ///< Repeat Counter for each nest REP block
 	std::stack<int> RepNumStack; ///< Repeat number for each nest REP block
@@ -131,6 +310,19 @@ private:
 	floatVec4 dst[SHADER_EXECUNIT], src[SHADER_EXECUNIT][3];
 	int texID, texType;
 
+	void SetupLane();
+
+	/// Does lane @a idx run the current instruction?
+	inline bool LaneRuns(int idx) const { return laneClass[idx] <= curDec->runLane; }
+
+	soaRegFile soa; ///< Register file of the structure-of-arrays engine
+	int soaLaneEnd; ///< Lanes after it are all disabled
+
+	void ExecuteSoA(const int *runCnt);
+	void PackLaneRun();
+	void PackLaneState();
+	void UnpackLaneState();
+
 	DRAM *dram;
 };
 
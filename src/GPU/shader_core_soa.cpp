@@ -0,0 +1,640 @@
+/*
+ * Copyright (c) 2013, Liou Jhe-Yu <lioujheyu@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ *	@file shader_core_soa.cpp
+ *  @brief ShaderCore structure-of-arrays execution engine
+ *
+ *	The engine executes one instruction for a group of SHADER_SOA_WIDTH lanes
+ *	with one host SIMD instruction. Every operation is written in the same
+ *	order as ShaderCore::Exec() and the floatVec4 helpers so that both engines
+ *	produce bit-identical results. Instructions which need a neighbor lane or
+ *	touch the texture unit and the flow control stacks are handed back to
+ *	ShaderCore::Exec() lane by lane.
+ */
+
+#include <algorithm>
+
+#include "shader_core.h"
+#include "shader_jit.h"
+#include "simd_lane.h"
+
+/// @name Lane vector primitives of the shader engine
+///@{
+///Boolean result of SEQ/SGE/... and CC register, 1.0 for true and 0.0 for false
+static inline lanef laneBool(lanem m) { return laneSel(m, laneSet(1.0f), laneSet(0.0f)); }
+///Same as CLAMP(v, lo, hi)
+static inline lanef laneClamp(lanef v, float lo, float hi)
+{
+	return laneSel(laneLt(v, laneSet(lo)), laneSet(lo),
+				   laneSel(laneGt(v, laneSet(hi)), laneSet(hi), v));
+}
+///@}
+
+/// Lane count alignment of soaLaneEnd, TEX and DDX/DDY need whole quads.
+#define SHADER_SOA_ALIGN ((SHADER_SOA_WIDTH > 4)? SHADER_SOA_WIDTH : 4)
+
+void ShaderCore::RunSoA()
+{
+	int i, j, c, a;
+	int runCnt[LANE_IDLE+1];
+	unsigned int attrUsed = 0;
+	const ShaderJIT::segment *seg;
+
+	soaLaneEnd = 0;
+	for (i=0; i<SHADER_EXECUNIT; i++) {
+		if (isEnable[i]) {
+			thread[i].isKilled = threadPtr[i]->isKilled;
+			soaLaneEnd = i + 1;
+		}
+	}
+	soaLaneEnd = (soaLaneEnd + SHADER_SOA_ALIGN - 1) / SHADER_SOA_ALIGN * SHADER_SOA_ALIGN;
+	SetupLane();
+	CountRunLane(runCnt);
+
+	//Only transpose the attributes which program really reads.
+	for (i=0; i<instCnt; i++) {
+		for (j=0; j<decPool[i].srcCnt; j++) {
+			if (decPool[i].src[j].type == INST_ATTRIB)
+				attrUsed |= 1 << decPool[i].src[j].id;
+		}
+	}
+
+	for (a=0; a<MAX_ATTRIBUTE_NUMBER; a++) {
+		if (!(attrUsed & (1 << a)))
+			continue;
+
+		for (i=0; i<soaLaneEnd; i++) {
+			for (c=0; c<4; c++)
+				soa.attr[a][c][i] = (isEnable[i])?
+								   Component(threadPtr[i]->attr[a], c) : 0.0f;
+		}
+	}
+
+	while(PC < instCnt) {
+		if (jit != nullptr && (seg = jit->SegmentAt(PC)) != nullptr) {
+			PackLaneState();
+			seg->func(&soa, jitConst, soaLaneEnd*sizeof(float), this);
+			UnpackLaneState();
+			CountRunLane(runCnt);
+			PC = seg->end;
+			continue;
+		}
+
+		curInst = instPool[PC];
+		curDec = &decPool[PC];
+
+		texID = curInst.tid;
+		texType = curInst.tType;
+
+		ExecuteSoA(runCnt);
+
+		if (laneMask && curInst.op == OP_KIL) {
+			SetupLane();
+			CountRunLane(runCnt);
+		}
+
+		PC++;
+	}
+
+	for (i=0; i<SHADER_EXECUNIT; i++) {
+		if (isEnable[i])
+			threadPtr[i]->isKilled = thread[i].isKilled;
+	}
+}
+
+/// Fetch, execute and write back curDec for every lane.
+void ShaderCore::ExecuteSoA(const int *runCnt)
+{
+	int i, j, c;
+
+	FetchSoA();
+
+	if (curDec->execSoA != nullptr)
+		(this->*curDec->execSoA)(runCnt);
+	else {
+		for (i=0; i<soaLaneEnd; i++) {
+			for (j=0; j<3; j++) {
+				src[i][j] = floatVec4(soa.src[j][0][i], soa.src[j][1][i],
+									  soa.src[j][2][i], soa.src[j][3][i]);
+			}
+		}
+
+		for (i=0; i<soaLaneEnd; i++) {
+			if (isEnable[i] && LaneRuns(i)) {
+				(this->*curDec->exec)(i);
+				for (c=0; c<4; c++)
+					soa.dst[c][i] = Component(dst[i], c);
+			}
+		}
+	}
+
+	WriteBackSoA();
+}
+
+void ShaderCore::FetchSoA()
+{
+	int i, c, l;
+
+	for (i=0; i<curDec->srcCnt; i++) {
+		const decodedOperand &opnd = curDec->src[i];
+
+		switch (opnd.type) {
+		case INST_ATTRIB:
+		case INST_REG:
+			{
+				const float (*plane)[SHADER_EXECUNIT] =
+					(opnd.type == INST_ATTRIB)? soa.attr[opnd.id] : soa.reg[opnd.id];
+
+				for (c=0; c<4; c++) {
+					for (l=0; l<soaLaneEnd; l+=SHADER_SOA_WIDTH)
+						laneStore(&soa.src[i][c][l], laneLoad(&plane[opnd.comp[c]][l]));
+				}
+			}
+			break;
+
+		case INST_CCREG:
+			for (c=0; c<4; c++) {
+				for (l=0; l<soaLaneEnd; l+=SHADER_SOA_WIDTH) {
+					laneStore(&soa.src[0][c][l],
+							  laneLoad(&soa.CCisSigned[opnd.id][opnd.comp[c]][l]));
+					laneStore(&soa.src[1][c][l],
+							  laneLoad(&soa.CCisZero[opnd.id][opnd.comp[c]][l]));
+				}
+			}
+			break;
+
+		case INST_CONSTANT:
+			for (c=0; c<4; c++) {
+				for (l=0; l<soaLaneEnd; l+=SHADER_SOA_WIDTH)
+					laneStore(&soa.src[i][c][l], laneSet(Component(opnd.val, c)));
+			}
+			break;
+
+		default:
+			fprintf(stderr,
+				"Shader(Exec): Unknown operand type \n");
+			return;
+		}
+
+		if (opnd.inverse) {
+			for (c=0; c<4; c++) {
+				for (l=0; l<soaLaneEnd; l+=SHADER_SOA_WIDTH)
+					laneStore(&soa.src[i][c][l], laneNeg(laneLoad(&soa.src[i][c][l])));
+			}
+		}
+
+		if (opnd.abs) {
+			for (c=0; c<4; c++) {
+				for (l=0; l<soaLaneEnd; l+=SHADER_SOA_WIDTH)
+					laneStore(&soa.src[i][c][l], laneAbs(laneLoad(&soa.src[i][c][l])));
+			}
+		}
+	}
+}
+
+/**
+ *	Apply @a func(src0, src1, src2) on every component of every lane and store
+ *	the result in the same component of soa.dst.
+ */
+template <typename Func>
+static inline void ComponentWise(float d[4][SHADER_EXECUNIT],
+								 const float s[3][4][SHADER_EXECUNIT],
+								 int laneEnd, Func func)
+{
+	for (int c=0; c<4; c++) {
+		for (int l=0; l<laneEnd; l+=SHADER_SOA_WIDTH)
+			laneStore(&d[c][l], func(laneLoad(&s[0][c][l]),
+									 laneLoad(&s[1][c][l]),
+									 laneLoad(&s[2][c][l])));
+	}
+}
+
+/**
+ *	Execute opcode @a op for all lanes in SoA form. Only the opcodes SoAExec()
+ *	hands out are instantiated.
+ *
+ *	@param runCnt How many enabled lanes run an instruction of each LANE_* class.
+ */
+template <int op>
+void ShaderCore::ExecSoA(const int *runCnt)
+{
+	int c, l;
+	lanef r, x, y, z, w;
+
+	switch (op) {
+	case OP_MOV:
+	case OP_I2F:
+		ComponentWise(soa.dst, soa.src, soaLaneEnd,
+			[](lanef a, lanef, lanef) { return a; });
+		break;
+	case OP_ABS:
+		ComponentWise(soa.dst, soa.src, soaLaneEnd,
+			[](lanef a, lanef, lanef) { return laneAbs(a); });
+		break;
+	case OP_ADD:
+		ComponentWise(soa.dst, soa.src, soaLaneEnd,
+			[](lanef a, lanef b, lanef) { return laneAdd(a, b); });
+		break;
+	case OP_SUB:
+		ComponentWise(soa.dst, soa.src, soaLaneEnd,
+			[](lanef a, lanef b, lanef) { return laneSub(a, b); });
+		break;
+	case OP_MUL:
+		ComponentWise(soa.dst, soa.src, soaLaneEnd,
+			[](lanef a, lanef b, lanef) { return laneMul(a, b); });
+		break;
+	case OP_DIV:
+		ComponentWise(soa.dst, soa.src, soaLaneEnd,
+			[](lanef a, lanef b, lanef) { return laneDiv(a, b); });
+		break;
+	case OP_MAD:
+		ComponentWise(soa.dst, soa.src, soaLaneEnd,
+			[](lanef a, lanef b, lanef c) { return laneAdd(laneMul(a, b), c); });
+		break;
+	case OP_MAX:
+		ComponentWise(soa.dst, soa.src, soaLaneEnd,
+			[](lanef a, lanef b, lanef) { return laneMax(a, b); });
+		break;
+	case OP_MIN:
+		ComponentWise(soa.dst, soa.src, soaLaneEnd,
+			[](lanef a, lanef b, lanef) { return laneMin(a, b); });
+		break;
+	case OP_SEQ:
+		ComponentWise(soa.dst, soa.src, soaLaneEnd,
+			[](lanef a, lanef b, lanef) { return laneBool(laneEq(a, b)); });
+		break;
+	case OP_SGE:
+		ComponentWise(soa.dst, soa.src, soaLaneEnd,
+			[](lanef a, lanef b, lanef) { return laneBool(laneGe(a, b)); });
+		break;
+	case OP_SGT:
+		ComponentWise(soa.dst, soa.src, soaLaneEnd,
+			[](lanef a, lanef b, lanef) { return laneBool(laneGt(a, b)); });
+		break;
+	case OP_SLE:
+		ComponentWise(soa.dst, soa.src, soaLaneEnd,
+			[](lanef a, lanef b, lanef) { return laneBool(laneLe(a, b)); });
+		break;
+	case OP_SLT:
+		ComponentWise(soa.dst, soa.src, soaLaneEnd,
+			[](lanef a, lanef b, lanef) { return laneBool(laneLt(a, b)); });
+		break;
+	case OP_SNE:
+		ComponentWise(soa.dst, soa.src, soaLaneEnd,
+			[](lanef a, lanef b, lanef) { return laneBool(laneNe(a, b)); });
+		break;
+
+	case OP_DP2:
+	case OP_DP3:
+	case OP_DP4:
+		for (l=0; l<soaLaneEnd; l+=SHADER_SOA_WIDTH) {
+			x = laneMul(laneLoad(&soa.src[0][0][l]), laneLoad(&soa.src[1][0][l]));
+			y = laneMul(laneLoad(&soa.src[0][1][l]), laneLoad(&soa.src[1][1][l]));
+			z = laneMul(laneLoad(&soa.src[0][2][l]), laneLoad(&soa.src[1][2][l]));
+			w = laneMul(laneLoad(&soa.src[0][3][l]), laneLoad(&soa.src[1][3][l]));
+
+			if (op == OP_DP2)
+				r = laneAdd(x, y);
+			else if (op == OP_DP3)
+				r = laneAdd(laneAdd(x, y), z);
+			else {
+			//Keep the same summation order as dot() in common.h
+#if defined(USE_SSE) && (defined(__SSE4_1__) || defined(__SSSE3__))
+				r = laneAdd(laneAdd(x, y), laneAdd(z, w));
+#elif defined(USE_SSE)
+				r = laneAdd(laneAdd(x, w), laneAdd(z, y));
+#else
+				r = laneAdd(laneAdd(laneAdd(x, y), z), w);
+#endif
+			}
+
+			for (c=0; c<4; c++)
+				laneStore(&soa.dst[c][l], r);
+		}
+		totalScaleOperation += runCnt[curDec->runLane] * DPScaleOperation(op);
+		break;
+
+	case OP_RCP:
+		for (l=0; l<soaLaneEnd; l+=SHADER_SOA_WIDTH) {
+			r = laneDiv(laneSet(1.0f), laneLoad(&soa.src[0][0][l]));
+			for (c=0; c<4; c++)
+				laneStore(&soa.dst[c][l], r);
+		}
+		break;
+
+	case OP_RSQ:
+		for (l=0; l<soaLaneEnd; l++)
+			soa.dst[0][l] = soa.dst[1][l] = soa.dst[2][l] = soa.dst[3][l] =
+				Q_rsqrt(soa.src[0][0][l]);
+		break;
+
+	case OP_CEIL:
+	case OP_FLR:
+	case OP_FRC:
+	case OP_ROUND:
+	case OP_TRUNC:
+		for (c=0; c<4; c++) {
+			for (l=0; l<soaLaneEnd; l++) {
+				float v = soa.src[0][c][l];
+
+				soa.dst[c][l] = (op == OP_CEIL)? ceil(v):
+							   (op == OP_FLR)? floor(v):
+							   (op == OP_FRC)? v - floor(v):
+							   (op == OP_ROUND)? round(v): trunc(v);
+			}
+		}
+		break;
+	}
+}
+
+soaExecFunc ShaderCore::SoAExec(int op)
+{
+#define SOA_EXEC(OP) case OP: return &ShaderCore::ExecSoA<OP>
+
+	switch (op) {
+	SOA_EXEC(OP_MOV); SOA_EXEC(OP_I2F); SOA_EXEC(OP_ABS);
+	SOA_EXEC(OP_ADD); SOA_EXEC(OP_SUB); SOA_EXEC(OP_MUL);
+	SOA_EXEC(OP_DIV); SOA_EXEC(OP_MAD); SOA_EXEC(OP_MAX);
+	SOA_EXEC(OP_MIN); SOA_EXEC(OP_SEQ); SOA_EXEC(OP_SGE);
+	SOA_EXEC(OP_SGT); SOA_EXEC(OP_SLE); SOA_EXEC(OP_SLT);
+	SOA_EXEC(OP_SNE); SOA_EXEC(OP_DP2); SOA_EXEC(OP_DP3);
+	SOA_EXEC(OP_DP4); SOA_EXEC(OP_RCP); SOA_EXEC(OP_RSQ);
+	SOA_EXEC(OP_CEIL); SOA_EXEC(OP_FLR); SOA_EXEC(OP_FRC);
+	SOA_EXEC(OP_ROUND); SOA_EXEC(OP_TRUNC);
+	default:
+		return nullptr;
+	}
+
+#undef SOA_EXEC
+}
+
+/**
+ *	Count the enabled lanes which run an instruction of each LANE_* class,
+ *	the lanes ShaderCore::Exec() would be called for whatever their condition.
+ */
+void ShaderCore::CountRunLane(int *runCnt) const
+{
+	for (int c=LANE_LIVE; c<=LANE_IDLE; c++)
+		runCnt[c] = 0;
+	for (int l=0; l<soaLaneEnd; l++) {
+		if (isEnable[l]) {
+			for (int c=laneClass[l]; c<=LANE_IDLE; c++)
+				runCnt[c]++;
+		}
+	}
+}
+
+/**
+ *	Mark the lanes which are enabled, pass the branch condition and run the
+ *	instructions, and count them in the statistic.
+ *
+ *	@param runLane	Lanes up to this LANE_* class run the instructions.
+ *	@param instLen	How many instructions the mask is used for.
+ *
+ *	@return How many lanes write back.
+ */
+int ShaderCore::UpdateWriteMask(int runLane, int instLen)
+{
+	int writeCnt = 0, helperCnt = 0, skipCnt = 0;
+	bool active;
+
+	for (int l=0; l<soaLaneEnd; l++) {
+		active = isEnable[l] && curCCState[l];
+		soa.writeMask[l] = (active && laneClass[l] <= runLane)? 1.0f : 0.0f;
+		writeCnt += (soa.writeMask[l] != 0.0f)? 1 : 0;
+		helperCnt += (soa.writeMask[l] != 0.0f && laneClass[l] != LANE_LIVE)? 1 : 0;
+		skipCnt += (active && laneClass[l] > runLane)? 1 : 0;
+	}
+
+	totalInstructionCnt += writeCnt * instLen;
+	helperInstructionCnt += helperCnt * instLen;
+	helperSkipCnt += skipCnt * instLen;
+	return writeCnt;
+}
+
+void ShaderCore::WriteBackSoA()
+{
+	int i, c, l;
+	int writeCnt = 0, attrID = -1;
+	float (*fvdst)[SHADER_EXECUNIT] = nullptr;
+	float attrVal[SHADER_EXECUNIT];
+	lanem m;
+	lanef v, r;
+
+	writeCnt = UpdateWriteMask(curDec->runLane, 1);
+
+	if (writeCnt == 0)
+		return;
+
+	switch (curDec->dstType) {
+	case INST_ATTRIB:
+		attrID = curDec->dstID;
+		break;
+
+	case INST_REG:
+		if (curDec->dstID >= 0)
+			fvdst = soa.reg[curDec->dstID];
+		break;
+
+	default:
+		return;
+	}
+
+	for (i=0; i<curDec->writeCnt; i++) {
+		c = curDec->writeComp[i];
+
+		for (l=0; l<soaLaneEnd; l+=SHADER_SOA_WIDTH) {
+			m = laneNe(laneLoad(&soa.writeMask[l]), laneSet(0.0f));
+			v = laneLoad(&soa.dst[c][l]);
+
+			if (curDec->satMode == 1)
+				r = laneClamp(v, 0.0f, 1.0f);
+			else if (curDec->satMode == 2)
+				r = laneClamp(v, -1.0f, 1.0f);
+			else
+				r = v;
+
+			if (fvdst != nullptr)
+				laneStore(&fvdst[c][l], laneSel(m, r, laneLoad(&fvdst[c][l])));
+			else if (attrID >= 0)
+				laneStore(&attrVal[l], r);
+
+			if (curDec->ccID >= 0) {
+				laneStore(&soa.CCisSigned[curDec->ccID][c][l],
+						  laneSel(m, laneBool(laneLt(v, laneSet(0.0f))),
+								  laneLoad(&soa.CCisSigned[curDec->ccID][c][l])));
+				laneStore(&soa.CCisZero[curDec->ccID][c][l],
+						  laneSel(m, laneBool(laneEq(v, laneSet(0.0f))),
+								  laneLoad(&soa.CCisZero[curDec->ccID][c][l])));
+			}
+		}
+
+		//Output attributes live in the thread itself, scatter them back.
+		if (attrID >= 0) {
+			for (l=0; l<soaLaneEnd; l++) {
+				if (soa.writeMask[l] != 0.0f)
+					Component(threadPtr[l]->attr[attrID], c) = attrVal[l];
+			}
+		}
+	}
+	totalScaleOperation += writeCnt * curDec->writeCnt;
+}
+
+/// Build the lane masks of the native code from laneClass.
+void ShaderCore::PackLaneRun()
+{
+	for (int l=0; l<soaLaneEnd; l++) {
+		for (int c=LANE_LIVE; c<=LANE_IDLE; c++)
+			soa.laneRun[c][l] = (isEnable[l] && laneClass[l] <= c)? -1 : 0;
+		soa.helper[l] = (isEnable[l] && laneClass[l] != LANE_LIVE)? -1 : 0;
+	}
+}
+
+/// Hand the branch condition, kill flag and lane classes to the native code.
+void ShaderCore::PackLaneState()
+{
+	for (int l=0; l<soaLaneEnd; l++) {
+		soa.ccState[l] = (curCCState[l])? -1 : 0;
+		soa.ccOuter[l] = (ccStack[l].empty() || ccStack[l].top())? -1 : 0;
+		soa.killed[l] = (thread[l].isKilled)? -1 : 0;
+		for (int s=0; s<JIT_STAT_NUM; s++)
+			soa.stat[s][l] = 0;
+	}
+	PackLaneRun();
+}
+
+/// Take the lane state and statistic back from the native code.
+void ShaderCore::UnpackLaneState()
+{
+	int sum[JIT_STAT_NUM] = {0};
+
+	for (int l=0; l<soaLaneEnd; l++) {
+		if (isEnable[l]) {
+			curCCState[l] = (soa.ccState[l] != 0);
+			thread[l].isKilled = (soa.killed[l] != 0);
+		}
+		for (int s=0; s<JIT_STAT_NUM; s++)
+			sum[s] += soa.stat[s][l];
+	}
+
+	totalInstructionCnt += sum[JIT_STAT_INST];
+	helperInstructionCnt += sum[JIT_STAT_HELPER];
+	helperSkipCnt += sum[JIT_STAT_SKIP];
+	totalScaleOperation += sum[JIT_STAT_SCALE];
+}
+
+/**
+ *	Run instruction @a pc by the SoA interpreter in the middle of native code,
+ *	for the opcodes ShaderJIT does not translate.
+ */
+void ShaderCore::JitInterpret(ShaderCore *core, int pc)
+{
+	int runCnt[LANE_IDLE+1];
+
+	for (int l=0; l<core->soaLaneEnd; l++) {
+		if (core->isEnable[l])
+			core->curCCState[l] = (core->soa.ccState[l] != 0);
+	}
+
+	core->curInst = core->instPool[pc];
+	core->curDec = &core->decPool[pc];
+	core->texID = core->curInst.tid;
+	core->texType = core->curInst.tType;
+
+	core->CountRunLane(runCnt);
+	core->ExecuteSoA(runCnt);
+}
+
+/**
+ *	Sample the texture of TEX/TXL/TXD/TXF @a pc for the lanes which run it.
+ *	The native code has fetched the coordinate to soa.src[0] and the texture
+ *	scale factors to soa.src[1] and soa.src[2], the texel is left in soa.dst.
+ */
+void ShaderCore::JitTexture(ShaderCore *core, int pc)
+{
+	const instruction &in = core->instPool[pc];
+	soaRegFile &rf = core->soa;
+	floatVec4 coord, color;
+
+	core->curDec = &core->decPool[pc];
+
+	for (int l=0; l<core->soaLaneEnd; l++) {
+		if (!core->isEnable[l] || !core->LaneRuns(l))
+			continue;
+
+		coord = floatVec4(rf.src[0][0][l], rf.src[0][1][l],
+						  rf.src[0][2][l], rf.src[0][3][l]);
+
+		switch (in.op) {
+		case OP_TEX:
+		case OP_TXD:
+			color = core->texUnit.TextureSample(coord,
+								-1,
+								floatVec4(rf.src[1][0][l], rf.src[1][1][l],
+										  rf.src[1][2][l], rf.src[1][3][l]),
+								floatVec4(rf.src[2][0][l], rf.src[2][1][l],
+										  rf.src[2][2][l], rf.src[2][3][l]),
+								in.tType,
+								in.tid );
+			break;
+		case OP_TXL:
+			color = core->texUnit.TextureSample(coord,
+								coord.w,
+								floatVec4(0.0, 0.0, 0.0, 0.0),
+								floatVec4(0.0, 0.0, 0.0, 0.0),
+								in.tType,
+								in.tid );
+			break;
+		default: // OP_TXF
+			color = core->texUnit.GetTexColor(coord, 0, in.tid);
+			break;
+		}
+
+		for (int c=0; c<4; c++)
+			rf.dst[c][l] = Component(color, c);
+	}
+}
+
+/// Scatter the output attribute written by @a pc to the masked threads.
+void ShaderCore::JitScatter(ShaderCore *core, int pc)
+{
+	const decodedInst &dec = core->decPool[pc];
+	soaRegFile &rf = core->soa;
+	int c;
+
+	for (int i=0; i<dec.writeCnt; i++) {
+		c = dec.writeComp[i];
+		for (int l=0; l<core->soaLaneEnd; l++) {
+			if (rf.write[l] != 0)
+				Component(core->threadPtr[l]->attr[dec.dstID], c) = rf.dst[c][l];
+		}
+	}
+}
+
+/// Apply the kill flags of the native code and reclassify the lanes.
+void ShaderCore::JitKill(ShaderCore *core, int)
+{
+	for (int l=0; l<core->soaLaneEnd; l++) {
+		if (core->isEnable[l])
+			core->thread[l].isKilled = (core->soa.killed[l] != 0);
+	}
+
+	if (core->laneMask) {
+		core->SetupLane();
+		core->PackLaneRun();
+	}
+}
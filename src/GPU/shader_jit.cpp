@@ -0,0 +1,1122 @@
+/*
+ * Copyright (c) 2013, Liou Jhe-Yu <lioujheyu@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ *	@file shader_jit.cpp
+ *  @brief ShaderJIT implementation
+ *
+ *	Generated function's calling convention is System V AMD64:
+ *	rdi = soaRegFile*, rsi = constant table, rdx = lane count in bytes and
+ *	rcx = ShaderCore*. They are kept in r12, r13, r14 and rbx across the
+ *	callbacks into ShaderCore. In a lane loop rcx is the lane byte offset of
+ *	the current 4-lane group and xmm15 holds its write mask. Every operation is
+ *	emitted in the same order as ShaderCore::Exec() so that the result is
+ *	bit-identical to the interpreter.
+ */
+
+#include <cstddef>
+#include <cstring>
+
+#include "shader_jit.h"
+
+#if defined(__x86_64__) && !defined(_WIN32)
+#	define SHADER_JIT_X86_64
+#	include <sys/mman.h>
+#	include <unistd.h>
+#endif
+
+/// @name Fixed slots in front of the constant table, 4 floats each
+///@{
+#define JIT_CONST_ZERO			0
+#define JIT_CONST_ONE			16
+#define JIT_CONST_SIGN			32 ///< -0.0, only sign bit is set
+#define JIT_CONST_HALF			48
+#define JIT_CONST_THREEHALFS	64
+#define JIT_CONST_MINUS_ONE		80
+#define JIT_CONST_RSQ_MAGIC		96 ///< 0x5f3759df of Q_rsqrt()
+#define JIT_CONST_TRUE			112 ///< All bits set, a lane mask of true
+#define JIT_CONST_FIXED_SIZE	128
+///@}
+
+/// @name How an instruction is translated
+///@{
+#define JIT_NONE	0 ///< Interpreted by ShaderCore, ends the segment
+#define JIT_ALU		1 ///< Part of a run of ALU instructions
+#define JIT_TEX		2
+#define JIT_FLOW	3 ///< IF, ELSE, ENDIF, REP or ENDREP
+#define JIT_KIL		4
+#define JIT_CALL	5 ///< Run by ShaderCore::JitInterpret()
+///@}
+
+/// @name Memory operand base
+///@{
+#define JIT_BASE_RF		0 ///< [rdi + rcx + disp32]
+#define JIT_BASE_CONST	1 ///< [rsi + disp32]
+///@}
+
+/// @name SSE opcode (second byte after 0x0F)
+///@{
+#define SSE_MOVAPS	0x28
+#define SSE_ANDPS	0x54
+#define SSE_ANDNPS	0x55
+#define SSE_ORPS	0x56
+#define SSE_XORPS	0x57
+#define SSE_ADDPS	0x58
+#define SSE_MULPS	0x59
+#define SSE_SUBPS	0x5c
+#define SSE_MINPS	0x5d
+#define SSE_DIVPS	0x5e
+#define SSE_MAXPS	0x5f
+#define SSE_CMPPS	0xc2
+#define SSE_PSRAD	0x72 ///< With 0x66 prefix and /4
+#define SSE_PSUBD	0xfa ///< With 0x66 prefix
+#define SSE_PADDD	0xfe ///< With 0x66 prefix
+#define SSE_SHUFPS	0xc6
+///@}
+
+/// @name Jcc opcode (second byte after 0x0F)
+///@{
+#define JCC_JB		0x82
+#define JCC_JE		0x84
+#define JCC_JNE		0x85
+///@}
+
+/// @name SHUFPS immediate picking lanes of a quad, 0 1 on top of 2 3
+///@{
+#define SHUF_RIGHT	0xf5 ///< 1 1 3 3
+#define SHUF_LEFT	0xa0 ///< 0 0 2 2
+#define SHUF_BOTTOM	0xee ///< 2 3 2 3
+#define SHUF_TOP	0x44 ///< 0 1 0 1
+///@}
+
+/// @name CMPPS predicate
+///@{
+#define CMP_EQ	0
+#define CMP_LT	1
+#define CMP_LE	2
+#define CMP_NEQ	4
+///@}
+
+/// Byte offset of component @a c of vector @a idx in a soaRegFile plane array
+static inline int32_t PlaneOffset(size_t base, int idx, int c)
+{
+	return (int32_t)(base + (idx*4 + c) * SHADER_EXECUNIT * sizeof(float));
+}
+
+#define RF_REG(id, c)			PlaneOffset(offsetof(soaRegFile, reg), id, c)
+#define RF_ATTR(id, c)			PlaneOffset(offsetof(soaRegFile, attr), id, c)
+#define RF_CCSIGNED(id, c)		PlaneOffset(offsetof(soaRegFile, CCisSigned), id, c)
+#define RF_CCZERO(id, c)		PlaneOffset(offsetof(soaRegFile, CCisZero), id, c)
+#define RF_SRC(k, c)			PlaneOffset(offsetof(soaRegFile, src), k, c)
+#define RF_DST(c)				PlaneOffset(offsetof(soaRegFile, dst), 0, c)
+/// Byte offset of lane mask @a i of a soaRegFile int plane array
+#define RF_PLANE(field, i)		((int32_t)(offsetof(soaRegFile, field) + \
+									   (i) * SHADER_EXECUNIT * sizeof(int)))
+#define RF_SCALAR(field, i)		((int32_t)(offsetof(soaRegFile, field) + (i) * sizeof(int)))
+
+/// Are the first @a need operands plain register, attribute or constant reads?
+static bool PlainSource(const decodedInst &dec, int need)
+{
+	if (dec.srcCnt < need)
+		return false;
+
+	for (int k=0; k<need; k++) {
+		if (dec.src[k].type != INST_ATTRIB &&
+			dec.src[k].type != INST_REG &&
+			dec.src[k].type != INST_CONSTANT)
+			return false;
+	}
+	return true;
+}
+
+/// Is the IF/KIL condition one ShaderCore::Exec() implements?
+static bool KnownCondition(const instruction &in, const decodedInst &dec)
+{
+	switch (in.src[0].ccMask) {
+	case CC_EQ: case CC_EQ0: case CC_EQ1:
+	case CC_NE: case CC_NE0: case CC_NE1:
+		return dec.srcCnt >= 1 && dec.src[0].type == INST_CCREG;
+	default:
+		return false;
+	}
+}
+
+/// @return JIT_* translation of an instruction
+static int Translation(const instruction &in, const decodedInst &dec)
+{
+	switch (in.op) {
+	case OP_MOV: case OP_I2F: case OP_ABS: case OP_RCP: case OP_RSQ:
+	case OP_DDX: case OP_DDY:
+		return PlainSource(dec, 1)? JIT_ALU : JIT_CALL;
+	case OP_ADD: case OP_SUB: case OP_MUL: case OP_DIV: case OP_MIN:
+	case OP_MAX: case OP_SEQ: case OP_SGE: case OP_SGT: case OP_SLE:
+	case OP_SLT: case OP_SNE: case OP_DP2: case OP_DP3: case OP_DP4:
+		return PlainSource(dec, 2)? JIT_ALU : JIT_CALL;
+	case OP_MAD:
+		return PlainSource(dec, 3)? JIT_ALU : JIT_CALL;
+	case OP_TEX: case OP_TXL: case OP_TXF:
+		return PlainSource(dec, 1)? JIT_TEX : JIT_CALL;
+	case OP_TXD:
+		return PlainSource(dec, 3)? JIT_TEX : JIT_CALL;
+	case OP_IF:
+		return KnownCondition(in, dec)? JIT_FLOW : JIT_NONE;
+	case OP_KIL:
+		return KnownCondition(in, dec)? JIT_KIL : JIT_NONE;
+	case OP_REP:
+		return PlainSource(dec, 1)? JIT_FLOW : JIT_NONE;
+	case OP_ELSE: case OP_ENDIF: case OP_ENDREP:
+		return JIT_FLOW;
+	default:
+		return JIT_CALL;
+	}
+}
+
+/// Leave the IF or REP block opened at @a open to the interpreter.
+static void Demote(const instruction *inst, const int *match, int open, int *kind)
+{
+	kind[open] = kind[match[open]] = JIT_NONE;
+	for (int pc=open+1; pc<match[open]; pc++) {
+		if (inst[pc].op == OP_ELSE && match[pc] == open)
+			kind[pc] = JIT_NONE;
+	}
+}
+
+/**
+ *	Pair the flow control instructions and give each compiled IF and REP a
+ *	nesting slot. A block which holds an interpreted instruction or nests
+ *	deeper than SHADER_JIT_MAX_NEST is interpreted as a whole, so every compiled
+ *	block lies inside one segment.
+ *
+ *	@param match	Receives the ENDIF/ENDREP of each IF/REP, and the IF/REP of
+ *					each ELSE, ENDIF and ENDREP.
+ *	@param slot		Receives the condition stack or loop counter slot of each
+ *					compiled flow control instruction.
+ */
+static void NestBlock(const instruction *inst, int instCnt, int *kind,
+					  int *match, int *slot)
+{
+	std::vector<int> open;
+	bool paired = true, changed = true;
+	int pc, i, ifDepth, repDepth, *depth;
+
+	for (pc=0; pc<instCnt && paired; pc++) {
+		switch (inst[pc].op) {
+		case OP_IF:
+		case OP_REP:
+			open.push_back(pc);
+			break;
+		case OP_ELSE:
+			paired = !open.empty() && inst[open.back()].op == OP_IF;
+			if (paired)
+				match[pc] = open.back();
+			break;
+		case OP_ENDIF:
+		case OP_ENDREP:
+			paired = !open.empty() && inst[open.back()].op ==
+					 ((inst[pc].op == OP_ENDIF)? OP_IF : OP_REP);
+			if (paired) {
+				match[pc] = open.back();
+				match[open.back()] = pc;
+				open.pop_back();
+			}
+			break;
+		}
+	}
+
+	if (!paired || !open.empty()) {
+		for (pc=0; pc<instCnt; pc++) {
+			if (kind[pc] == JIT_FLOW)
+				kind[pc] = JIT_NONE;
+		}
+		return;
+	}
+
+	while (changed) {
+		changed = false;
+
+		for (pc=0; pc<instCnt; pc++) {
+			if (kind[pc] != JIT_FLOW ||
+				(inst[pc].op != OP_IF && inst[pc].op != OP_REP))
+				continue;
+
+			for (i=pc+1; i<match[pc] && kind[i] != JIT_NONE; i++);
+			if (i < match[pc]) {
+				Demote(inst, match, pc, kind);
+				changed = true;
+			}
+		}
+
+		ifDepth = repDepth = 0;
+		for (pc=0; pc<instCnt; pc++) {
+			if (kind[pc] != JIT_FLOW)
+				continue;
+
+			switch (inst[pc].op) {
+			case OP_IF:
+			case OP_REP:
+				depth = (inst[pc].op == OP_IF)? &ifDepth : &repDepth;
+				if (*depth == SHADER_JIT_MAX_NEST) {
+					Demote(inst, match, pc, kind);
+					changed = true;
+				}
+				else
+					slot[pc] = (*depth)++;
+				break;
+			case OP_ELSE:
+				slot[pc] = slot[match[pc]];
+				break;
+			case OP_ENDIF:
+				slot[pc] = --ifDepth;
+				break;
+			case OP_ENDREP:
+				slot[pc] = --repDepth;
+				break;
+			}
+		}
+	}
+}
+
+ShaderJIT::ShaderJIT(const instruction *inst, int instCnt, const int *runLane) :
+	constSize(JIT_CONST_FIXED_SIZE/sizeof(float)),
+	nativeInstCnt(0),
+	execMem(nullptr),
+	execSize(0)
+{
+	// Operand structure doesn't depend on the uniform values.
+	static floatVec4 noUniform[MAX_UNIFORM_VECTORS];
+	std::vector<decodedInst> dec(instCnt);
+
+	DecodeProgram(inst, instCnt, noUniform, dec.data());
+	segIdx.assign(instCnt, -1);
+	constOffset.assign(instCnt*3, -1);
+
+#ifdef SHADER_JIT_X86_64
+	std::vector<int> kind(instCnt), lane(instCnt), match(instCnt, -1), slot(instCnt, 0);
+	std::vector<size_t> entry;
+	int pc, end, native;
+
+	for (pc=0; pc<instCnt; pc++) {
+		kind[pc] = Translation(inst[pc], dec[pc]);
+		lane[pc] = (runLane != nullptr)? runLane[pc] : LANE_IDLE;
+	}
+	NestBlock(inst, instCnt, kind.data(), match.data(), slot.data());
+
+	pc = 0;
+	while (pc < instCnt) {
+		native = 0;
+		for (end=pc; end<instCnt && kind[end] != JIT_NONE; end++)
+			native += (kind[end] != JIT_CALL)? 1 : 0;
+
+		// Code which only calls back into the interpreter is not worth entering.
+		if (native == 0) {
+			pc = (end > pc)? end : pc + 1;
+			continue;
+		}
+
+		segment s;
+		s.start = pc;
+		s.end = end;
+		s.func = nullptr;
+		entry.push_back(code.size());
+		EmitSegment(inst, dec.data(), kind.data(), lane.data(), slot.data(), pc, end);
+
+		segIdx[s.start] = seg.size();
+		seg.push_back(s);
+		pc = end;
+	}
+
+	if (seg.empty())
+		return;
+
+	size_t pageSize = sysconf(_SC_PAGESIZE);
+	execSize = (code.size() + pageSize - 1) / pageSize * pageSize;
+	execMem = mmap(nullptr, execSize, PROT_READ | PROT_WRITE,
+				   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (execMem != MAP_FAILED) {
+		memcpy(execMem, code.data(), code.size());
+		if (mprotect(execMem, execSize, PROT_READ | PROT_EXEC) != 0) {
+			munmap(execMem, execSize);
+			execMem = MAP_FAILED;
+		}
+	}
+
+	if (execMem == MAP_FAILED) {
+		fprintf(stderr, "ShaderJIT: Cannot allocate executable memory\n");
+		execMem = nullptr;
+		seg.clear();
+		segIdx.assign(instCnt, -1);
+		nativeInstCnt = 0;
+	}
+	else {
+		for (unsigned int i=0; i<seg.size(); i++)
+			seg[i].func = (segmentFunc)((uint8_t*)execMem + entry[i]);
+	}
+	code.clear();
+#endif // SHADER_JIT_X86_64
+}
+
+ShaderJIT::~ShaderJIT()
+{
+#ifdef SHADER_JIT_X86_64
+	if (execMem != nullptr)
+		munmap(execMem, execSize);
+#endif
+}
+
+void ShaderJIT::FillConstant(const decodedInst *dec, float *table) const
+{
+	int32_t magic = 0x5f3759df, allSet = -1;
+
+	for (int l=0; l<4; l++) {
+		table[JIT_CONST_ZERO/4 + l] = 0.0f;
+		table[JIT_CONST_ONE/4 + l] = 1.0f;
+		table[JIT_CONST_SIGN/4 + l] = -0.0f;
+		table[JIT_CONST_HALF/4 + l] = 0.5f;
+		table[JIT_CONST_THREEHALFS/4 + l] = 1.5f;
+		table[JIT_CONST_MINUS_ONE/4 + l] = -1.0f;
+		memcpy(&table[JIT_CONST_RSQ_MAGIC/4 + l], &magic, sizeof(float));
+		memcpy(&table[JIT_CONST_TRUE/4 + l], &allSet, sizeof(float));
+	}
+
+	for (unsigned int i=0; i<literal.size(); i++) {
+		for (int l=0; l<4; l++)
+			memcpy(&table[literal[i].first/4 + l], &literal[i].second, sizeof(float));
+	}
+
+	for (unsigned int i=0; i<constOffset.size(); i++) {
+		if (constOffset[i] < 0)
+			continue;
+
+		for (int c=0; c<4; c++) {
+			for (int l=0; l<4; l++)
+				table[constOffset[i]/4 + c*4 + l] =
+					Component(dec[i/3].src[i%3].val, c);
+		}
+	}
+}
+
+/// Give each constant operand of @a dec its slot in the constant table.
+void ShaderJIT::AllocConst(const decodedInst &dec, int pc)
+{
+	for (int i=0; i<dec.srcCnt; i++) {
+		if (dec.src[i].type == INST_CONSTANT && constOffset[pc*3 + i] < 0) {
+			constOffset[pc*3 + i] = constSize * sizeof(float);
+			constSize += 16;
+		}
+	}
+}
+
+/// @return Table offset of 4 copies of the integer @a v
+int ShaderJIT::Literal(int32_t v)
+{
+	for (unsigned int i=0; i<literal.size(); i++) {
+		if (literal[i].second == v)
+			return literal[i].first;
+	}
+
+	literal.push_back(std::make_pair((int)(constSize * sizeof(float)), v));
+	constSize += 4;
+	return literal.back().first;
+}
+
+/**
+ *	Emit one function for instructions [@a start, @a end). Consecutive ALU
+ *	instructions run by the same lanes share a lane loop, everything else
+ *	loops over the lanes by itself.
+ */
+void ShaderJIT::EmitSegment(const instruction *inst, const decodedInst *dec,
+							const int *kind, const int *lane, const int *slot,
+							int start, int end)
+{
+	std::vector<size_t> loopStart(SHADER_JIT_MAX_NEST);
+	int pc = start, last;
+
+	// Keep the arguments in callee-saved registers across the callbacks.
+	// r15 is only pushed to keep the stack 16-byte aligned for them.
+	Emit(0x53);							// push rbx
+	Emit(0x41); Emit(0x54);				// push r12
+	Emit(0x41); Emit(0x55);				// push r13
+	Emit(0x41); Emit(0x56);				// push r14
+	Emit(0x41); Emit(0x57);				// push r15
+	Emit(0x49); Emit(0x89); Emit(0xfc);	// mov r12, rdi
+	Emit(0x49); Emit(0x89); Emit(0xf5);	// mov r13, rsi
+	Emit(0x49); Emit(0x89); Emit(0xd6);	// mov r14, rdx
+	Emit(0x48); Emit(0x89); Emit(0xcb);	// mov rbx, rcx
+
+	while (pc < end) {
+		switch (kind[pc]) {
+		case JIT_ALU:
+			// An output attribute ends the run, it is scattered after the loop.
+			for (last=pc+1; last<end && kind[last] == JIT_ALU &&
+				 lane[last] == lane[pc] && dec[last-1].dstType != INST_ATTRIB; last++);
+			EmitRun(inst, dec, lane[pc], pc, last);
+			nativeInstCnt += last - pc;
+			pc = last;
+			continue;
+		case JIT_TEX:
+			EmitTexture(inst[pc], dec[pc], lane[pc], pc);
+			break;
+		case JIT_FLOW:
+			EmitFlow(inst[pc], dec[pc], lane[pc], slot[pc], pc, loopStart);
+			break;
+		case JIT_KIL:
+			EmitKill(inst[pc], dec[pc], lane[pc], pc);
+			break;
+		default:
+			EmitCall(&ShaderCore::JitInterpret, pc);
+			break;
+		}
+
+		nativeInstCnt += (kind[pc] != JIT_CALL)? 1 : 0;
+		pc++;
+	}
+
+	Emit(0x41); Emit(0x5f);				// pop r15
+	Emit(0x41); Emit(0x5e);				// pop r14
+	Emit(0x41); Emit(0x5d);				// pop r13
+	Emit(0x41); Emit(0x5c);				// pop r12
+	Emit(0x5b);							// pop rbx
+	Emit(0xc3);							// ret
+}
+
+/// Emit ALU instructions [@a start, @a end) as one lane loop.
+void ShaderJIT::EmitRun(const instruction *inst, const decodedInst *dec, int lane,
+						int start, int end)
+{
+	int pc, writeCnt = 0, laneOpCnt = 0;
+	bool attrOut = (dec[end-1].dstType == INST_ATTRIB);
+	size_t loopStart;
+
+	for (pc=start; pc<end; pc++) {
+		AllocConst(dec[pc], pc);
+		if (dec[pc].dstType == INST_REG || dec[pc].dstType == INST_ATTRIB)
+			writeCnt += dec[pc].writeCnt;
+		laneOpCnt += DPScaleOperation(inst[pc].op);
+	}
+
+	loopStart = EmitLoopBegin();
+	EmitMask(lane, end - start, writeCnt, laneOpCnt, attrOut);
+	for (pc=start; pc<end; pc++) {
+		EmitCompute(dec[pc], inst[pc].op, pc);
+		EmitWriteBack(dec[pc]);
+	}
+	EmitLoopEnd(loopStart);
+
+	if (attrOut)
+		EmitCall(&ShaderCore::JitScatter, end - 1);
+}
+
+/**
+ *	Emit TEX/TXL/TXD/TXF. The operands and the texture scale factors are
+ *	fetched for every lane first, as ShaderCore::Exec() takes the difference
+ *	with the neighbor lanes, then ShaderCore::JitTexture() samples the texture
+ *	lane by lane and the texels are written back.
+ */
+void ShaderJIT::EmitTexture(const instruction &in, const decodedInst &dec,
+							int lane, int pc)
+{
+	int k, c, srcCnt = (in.op == OP_TXD)? 3 : 1;
+	bool attrOut = (dec.dstType == INST_ATTRIB);
+	size_t loopStart;
+
+	AllocConst(dec, pc);
+
+	loopStart = EmitLoopBegin();
+	for (k=0; k<srcCnt; k++) {
+		for (c=0; c<4; c++) {
+			LoadSrc(dec.src[k], pc, k, c, 0);
+			EmitStore(0, RF_SRC(k, c));
+
+			if (in.op == OP_TEX) {
+				EmitRR(false, SSE_MOVAPS, 1, 0);
+				EmitRR(false, SSE_MOVAPS, 2, 0);
+				EmitRR(false, SSE_MOVAPS, 3, 0);
+				EmitShuffle(0, SHUF_RIGHT);
+				EmitShuffle(1, SHUF_LEFT);
+				EmitRR(false, SSE_SUBPS, 0, 1);
+				EmitStore(0, RF_SRC(1, c));
+				EmitShuffle(2, SHUF_BOTTOM);
+				EmitShuffle(3, SHUF_TOP);
+				EmitRR(false, SSE_SUBPS, 2, 3);
+				EmitStore(2, RF_SRC(2, c));
+			}
+		}
+	}
+	EmitLoopEnd(loopStart);
+
+	EmitCall(&ShaderCore::JitTexture, pc);
+
+	loopStart = EmitLoopBegin();
+	EmitMask(lane, 1, (dec.dstType == INST_NO_TYPE)? 0 : dec.writeCnt, 0, attrOut);
+	EmitWriteBack(dec);
+	EmitLoopEnd(loopStart);
+
+	if (attrOut)
+		EmitCall(&ShaderCore::JitScatter, pc);
+}
+
+/**
+ *	Emit IF/ELSE/ENDIF as updates of the per-lane condition masks and REP/ENDREP
+ *	as a native loop, the same as ShaderCore::Exec().
+ *
+ *	@param slot			Condition stack entry or loop counter of the block.
+ *	@param loopStart	Code offset of the loop body of each REP slot.
+ */
+void ShaderJIT::EmitFlow(const instruction &in, const decodedInst &dec, int lane,
+						 int slot, int pc, std::vector<size_t> &loopStart)
+{
+	size_t loop, skip;
+
+	switch (in.op) {
+	case OP_REP:
+		// Lane 0 drives the loop, the body runs once if it is disabled.
+		AllocConst(dec, pc);
+		Emit(0x83); Emit(0xbf); Emit32(RF_PLANE(laneRun, LANE_IDLE)); Emit(0); // cmp dword [rdi + disp32], 0
+		skip = EmitJump(JCC_JE);
+		Emit(0x31); Emit(0xc9);									// xor ecx, ecx
+		LoadSrc(dec.src[0], pc, 0, 0, 0);
+		Emit(0xf3); Emit(0x0f); Emit(0x2c); Emit(0xc0);			// cvttss2si eax, xmm0
+		Emit(0x89); Emit(0x87); Emit32(RF_SCALAR(repNum, slot));	// mov [rdi + disp32], eax
+		Emit(0xc7); Emit(0x87); Emit32(RF_SCALAR(repCnt, slot)); Emit32(0); // mov dword [rdi + disp32], 0
+		Emit(0x83); Emit(0x87); Emit32(RF_PLANE(stat, JIT_STAT_SCALE)); Emit(1); // add dword [rdi + disp32], 1
+		PatchJump(skip);
+
+		loop = EmitLoopBegin();
+		EmitMask(lane, 1, 0, 0, false);
+		EmitLoopEnd(loop);
+		loopStart[slot] = code.size();
+		break;
+
+	case OP_ENDREP:
+		loop = EmitLoopBegin();
+		EmitMask(lane, 1, 0, 0, false);
+		EmitLoopEnd(loop);
+
+		Emit(0x83); Emit(0xbf); Emit32(RF_PLANE(laneRun, LANE_IDLE)); Emit(0); // cmp dword [rdi + disp32], 0
+		skip = EmitJump(JCC_JE);
+		Emit(0x83); Emit(0x87); Emit32(RF_PLANE(stat, JIT_STAT_SCALE)); Emit(1); // add dword [rdi + disp32], 1
+		Emit(0x8b); Emit(0x87); Emit32(RF_SCALAR(repCnt, slot));	// mov eax, [rdi + disp32]
+		Emit(0x83); Emit(0xc0); Emit(1);							// add eax, 1
+		Emit(0x89); Emit(0x87); Emit32(RF_SCALAR(repCnt, slot));	// mov [rdi + disp32], eax
+		Emit(0x3b); Emit(0x87); Emit32(RF_SCALAR(repNum, slot));	// cmp eax, [rdi + disp32]
+		EmitJumpTo(JCC_JNE, loopStart[slot]);
+		PatchJump(skip);
+		break;
+
+	// Flow control is run by every enabled lane, see HelperLaneAnalysis().
+	case OP_IF:
+		loop = EmitLoopBegin();
+		EmitCondition(in, dec);
+		EmitLoad(1, JIT_BASE_RF, RF_PLANE(ccState, 0));
+		EmitRR(false, SSE_ANDPS, 1, 0);
+		EmitStore(1, RF_PLANE(ccState, 0));
+		EmitStore(1, RF_PLANE(ccStack, slot));
+		EmitMask(lane, 1, 0, 1, false);
+		EmitLoopEnd(loop);
+		break;
+
+	case OP_ELSE:
+		loop = EmitLoopBegin();
+		EmitLoad(1, JIT_BASE_RF, RF_PLANE(ccStack, slot));
+		EmitLoad(2, JIT_BASE_CONST, JIT_CONST_TRUE);
+		EmitRR(false, SSE_XORPS, 1, 2);
+		EmitStore(1, RF_PLANE(ccState, 0));
+		EmitMask(lane, 1, 0, 1, false);
+		EmitLoopEnd(loop);
+		break;
+
+	case OP_ENDIF:
+		loop = EmitLoopBegin();
+		EmitLoad(1, JIT_BASE_RF, (slot > 0)? RF_PLANE(ccStack, slot - 1) :
+											 RF_PLANE(ccOuter, 0));
+		EmitStore(1, RF_PLANE(ccState, 0));
+		EmitMask(lane, 1, 0, 1, false);
+		EmitLoopEnd(loop);
+		break;
+	}
+}
+
+/// Emit KIL as an update of the kill mask, then let ShaderCore reclassify the lanes.
+void ShaderJIT::EmitKill(const instruction &in, const decodedInst &dec, int lane, int pc)
+{
+	size_t loop;
+
+	loop = EmitLoopBegin();
+	EmitCondition(in, dec);
+	EmitLoad(1, JIT_BASE_RF, RF_PLANE(ccState, 0));
+	EmitRR(false, SSE_ANDPS, 0, 1);
+	EmitLoad(1, JIT_BASE_RF, RF_PLANE(laneRun, lane));
+	EmitRR(false, SSE_ANDPS, 0, 1);
+	EmitLoad(1, JIT_BASE_RF, RF_PLANE(killed, 0));
+	EmitRR(false, SSE_ORPS, 1, 0);
+	EmitStore(1, RF_PLANE(killed, 0));
+	EmitMask(lane, 1, 0, 0, false);
+	EmitLoopEnd(loop);
+
+	EmitCall(&ShaderCore::JitKill, pc);
+}
+
+/**
+ *	Evaluate the CC condition of IF/KIL into xmm0 as a lane mask, xmm1-3 and
+ *	xmm6 are clobbered. src0 holds CCisSigned and src1 CCisZero as in
+ *	ShaderCore::FetchData().
+ */
+void ShaderJIT::EmitCondition(const instruction &in, const decodedInst &dec)
+{
+	const decodedOperand &opnd = dec.src[0];
+	bool eq = (in.src[0].ccMask == CC_EQ || in.src[0].ccMask == CC_EQ0 ||
+			   in.src[0].ccMask == CC_EQ1);
+
+	for (int c=0; c<4; c++) {
+		LoadSrc(opnd, 0, 0, c, 1);
+		EmitLoad(2, JIT_BASE_RF, RF_CCZERO(opnd.id, opnd.comp[c]));
+		EmitLoad(3, JIT_BASE_CONST, JIT_CONST_ONE);
+
+		if (eq) { // !(src0 == 1.0) && (src1 == 1.0)
+			EmitCmp(1, 3, CMP_NEQ);
+			EmitCmp(2, 3, CMP_EQ);
+			EmitRR(false, SSE_ANDPS, 1, 2);
+		}
+		else { // (src0 == 1.0) || !(src1 == 1.0)
+			EmitCmp(1, 3, CMP_EQ);
+			EmitCmp(2, 3, CMP_NEQ);
+			EmitRR(false, SSE_ORPS, 1, 2);
+		}
+
+		if (c == 0)
+			EmitRR(false, SSE_MOVAPS, 0, 1);
+		else
+			EmitRR(false, SSE_ORPS, 0, 1);
+	}
+}
+
+/**
+ *	Set xmm15 to the lanes which pass the branch condition and run class
+ *	@a lane, and count the statistic of @a instCnt instructions under it the
+ *	same as ShaderCore::UpdateWriteMask(). xmm8-14 are clobbered.
+ *
+ *	@param writeCnt		Components written back by each masked lane.
+ *	@param laneOpCnt	Scale operations of each running lane, whatever its
+ *						condition.
+ *	@param attrOut		Keep the mask in soaRegFile::write for JitScatter().
+ */
+void ShaderJIT::EmitMask(int lane, int instCnt, int writeCnt, int laneOpCnt, bool attrOut)
+{
+	EmitLoad(8, JIT_BASE_RF, RF_PLANE(ccState, 0));
+	EmitLoad(9, JIT_BASE_RF, RF_PLANE(laneRun, lane));
+	EmitRR(false, SSE_MOVAPS, 15, 8);
+	EmitRR(false, SSE_ANDPS, 15, 9);
+	if (attrOut)
+		EmitStore(15, RF_PLANE(write, 0));
+
+	EmitLoad(12, JIT_BASE_CONST, Literal(instCnt));
+	EmitRR(false, SSE_MOVAPS, 10, 15);
+	EmitRR(false, SSE_ANDPS, 10, 12);
+	EmitLoad(11, JIT_BASE_RF, RF_PLANE(stat, JIT_STAT_INST));
+	EmitRR(true, SSE_PADDD, 11, 10);
+	EmitStore(11, RF_PLANE(stat, JIT_STAT_INST));
+
+	EmitLoad(10, JIT_BASE_RF, RF_PLANE(helper, 0));
+	EmitRR(false, SSE_ANDPS, 10, 15);
+	EmitRR(false, SSE_ANDPS, 10, 12);
+	EmitLoad(11, JIT_BASE_RF, RF_PLANE(stat, JIT_STAT_HELPER));
+	EmitRR(true, SSE_PADDD, 11, 10);
+	EmitStore(11, RF_PLANE(stat, JIT_STAT_HELPER));
+
+	// Enabled lanes which pass the condition but skip this class
+	if (lane != LANE_IDLE) {
+		EmitLoad(10, JIT_BASE_RF, RF_PLANE(laneRun, LANE_IDLE));
+		EmitRR(false, SSE_ANDPS, 10, 8);
+		EmitRR(false, SSE_MOVAPS, 11, 9);
+		EmitRR(false, SSE_ANDNPS, 11, 10);
+		EmitRR(false, SSE_ANDPS, 11, 12);
+		EmitLoad(13, JIT_BASE_RF, RF_PLANE(stat, JIT_STAT_SKIP));
+		EmitRR(true, SSE_PADDD, 13, 11);
+		EmitStore(13, RF_PLANE(stat, JIT_STAT_SKIP));
+	}
+
+	if (writeCnt > 0 || laneOpCnt > 0) {
+		if (writeCnt > 0) {
+			EmitLoad(10, JIT_BASE_CONST, Literal(writeCnt));
+			EmitRR(false, SSE_ANDPS, 10, 15);
+		}
+		if (laneOpCnt > 0) {
+			EmitLoad(11, JIT_BASE_CONST, Literal(laneOpCnt));
+			EmitRR(false, SSE_ANDPS, 11, 9);
+			if (writeCnt > 0)
+				EmitRR(true, SSE_PADDD, 10, 11);
+			else
+				EmitRR(false, SSE_MOVAPS, 10, 11);
+		}
+		EmitLoad(13, JIT_BASE_RF, RF_PLANE(stat, JIT_STAT_SCALE));
+		EmitRR(true, SSE_PADDD, 13, 10);
+		EmitStore(13, RF_PLANE(stat, JIT_STAT_SCALE));
+	}
+}
+
+/**
+ *	Compute every written component of an ALU instruction into rf->dst first,
+ *	so that a swizzled source is not overwritten by its own destination.
+ */
+void ShaderJIT::EmitCompute(const decodedInst &dec, int op, int pc)
+{
+	int i, c, n;
+	const decodedOperand *s = dec.src;
+
+	if (dec.dstType == INST_NO_TYPE || dec.writeCnt == 0)
+		return;
+
+	switch (op) {
+	case OP_DP2:
+	case OP_DP3:
+	case OP_DP4:
+		n = (op == OP_DP2)? 2: (op == OP_DP3)? 3: 4;
+		for (c=0; c<n; c++) {
+			LoadSrc(s[0], pc, 0, c, c);
+			LoadSrc(s[1], pc, 1, c, 4);
+			EmitRR(false, SSE_MULPS, c, 4);
+		}
+
+		if (op == OP_DP2)
+			EmitRR(false, SSE_ADDPS, 0, 1);
+		else if (op == OP_DP3) {
+			EmitRR(false, SSE_ADDPS, 0, 1);
+			EmitRR(false, SSE_ADDPS, 0, 2);
+		}
+		else {
+		//Keep the same summation order as dot() in common.h
+#if defined(USE_SSE) && (defined(__SSE4_1__) || defined(__SSSE3__))
+			EmitRR(false, SSE_ADDPS, 0, 1);
+			EmitRR(false, SSE_ADDPS, 2, 3);
+			EmitRR(false, SSE_ADDPS, 0, 2);
+#elif defined(USE_SSE)
+			EmitRR(false, SSE_ADDPS, 0, 3);
+			EmitRR(false, SSE_ADDPS, 2, 1);
+			EmitRR(false, SSE_ADDPS, 0, 2);
+#else
+			EmitRR(false, SSE_ADDPS, 0, 1);
+			EmitRR(false, SSE_ADDPS, 0, 2);
+			EmitRR(false, SSE_ADDPS, 0, 3);
+#endif
+		}
+
+		for (i=0; i<dec.writeCnt; i++)
+			EmitStore(0, RF_DST(dec.writeComp[i]));
+		break;
+
+	case OP_RCP:
+		LoadSrc(s[0], pc, 0, 0, 1);
+		EmitLoad(0, JIT_BASE_CONST, JIT_CONST_ONE);
+		EmitRR(false, SSE_DIVPS, 0, 1);
+		for (i=0; i<dec.writeCnt; i++)
+			EmitStore(0, RF_DST(dec.writeComp[i]));
+		break;
+
+	case OP_RSQ: // Q_rsqrt()
+		LoadSrc(s[0], pc, 0, 0, 0);
+		EmitRR(false, SSE_MOVAPS, 1, 0);
+		EmitLoad(6, JIT_BASE_CONST, JIT_CONST_HALF);
+		EmitRR(false, SSE_MULPS, 1, 6);				// x2 = number * 0.5
+		EmitRR(false, SSE_MOVAPS, 2, 0);
+		EmitRR(true, SSE_PSRAD, 4, 2); Emit(1);		// i >> 1
+		EmitLoad(3, JIT_BASE_CONST, JIT_CONST_RSQ_MAGIC);
+		EmitRR(true, SSE_PSUBD, 3, 2);				// y = magic - (i >> 1)
+		EmitRR(false, SSE_MULPS, 1, 3);
+		EmitRR(false, SSE_MULPS, 1, 3);				// x2 * y * y
+		EmitLoad(4, JIT_BASE_CONST, JIT_CONST_THREEHALFS);
+		EmitRR(false, SSE_SUBPS, 4, 1);
+		EmitRR(false, SSE_MULPS, 3, 4);
+		for (i=0; i<dec.writeCnt; i++)
+			EmitStore(3, RF_DST(dec.writeComp[i]));
+		break;
+
+	case OP_DDX:
+	case OP_DDY:
+		for (i=0; i<dec.writeCnt; i++) {
+			c = dec.writeComp[i];
+			LoadSrc(s[0], pc, 0, c, 0);
+			EmitRR(false, SSE_MOVAPS, 1, 0);
+			EmitShuffle(0, (op == OP_DDX)? SHUF_RIGHT : SHUF_BOTTOM);
+			EmitShuffle(1, (op == OP_DDX)? SHUF_LEFT : SHUF_TOP);
+			EmitRR(false, SSE_SUBPS, 0, 1);
+			EmitStore(0, RF_DST(c));
+		}
+		break;
+
+	default:
+		for (i=0; i<dec.writeCnt; i++) {
+			c = dec.writeComp[i];
+
+			LoadSrc(s[0], pc, 0, c, 0);
+			if (op != OP_MOV && op != OP_I2F && op != OP_ABS)
+				LoadSrc(s[1], pc, 1, c, 1);
+			if (op == OP_MAD)
+				LoadSrc(s[2], pc, 2, c, 2);
+
+			switch (op) {
+			case OP_ABS:
+				EmitLoad(6, JIT_BASE_CONST, JIT_CONST_SIGN);
+				EmitRR(false, SSE_ANDNPS, 6, 0);
+				EmitRR(false, SSE_MOVAPS, 0, 6);
+				break;
+			case OP_ADD: EmitRR(false, SSE_ADDPS, 0, 1); break;
+			case OP_SUB: EmitRR(false, SSE_SUBPS, 0, 1); break;
+			case OP_MUL: EmitRR(false, SSE_MULPS, 0, 1); break;
+			case OP_DIV: EmitRR(false, SSE_DIVPS, 0, 1); break;
+			case OP_MIN: EmitRR(false, SSE_MINPS, 0, 1); break;
+			case OP_MAX: EmitRR(false, SSE_MAXPS, 0, 1); break;
+			case OP_MAD:
+				EmitRR(false, SSE_MULPS, 0, 1);
+				EmitRR(false, SSE_ADDPS, 0, 2);
+				break;
+			case OP_SEQ: EmitCmp(0, 1, CMP_EQ); break;
+			case OP_SLT: EmitCmp(0, 1, CMP_LT); break;
+			case OP_SLE: EmitCmp(0, 1, CMP_LE); break;
+			case OP_SNE: EmitCmp(0, 1, CMP_NEQ); break;
+			case OP_SGT:
+				EmitCmp(1, 0, CMP_LT);
+				EmitRR(false, SSE_MOVAPS, 0, 1);
+				break;
+			case OP_SGE:
+				EmitCmp(1, 0, CMP_LE);
+				EmitRR(false, SSE_MOVAPS, 0, 1);
+				break;
+			}
+
+			if (op == OP_SEQ || op == OP_SGE || op == OP_SGT ||
+				op == OP_SLE || op == OP_SLT || op == OP_SNE) {
+				EmitLoad(6, JIT_BASE_CONST, JIT_CONST_ONE);
+				EmitRR(false, SSE_ANDPS, 0, 6);
+			}
+
+			EmitStore(0, RF_DST(c));
+		}
+		break;
+	}
+}
+
+/// Write rf->dst back by xmm15, the same as ShaderCore::WriteBackSoA().
+void ShaderJIT::EmitWriteBack(const decodedInst &dec)
+{
+	int i, c;
+
+	if (dec.dstType == INST_NO_TYPE)
+		return;
+
+	for (i=0; i<dec.writeCnt; i++) {
+		c = dec.writeComp[i];
+		EmitLoad(0, JIT_BASE_RF, RF_DST(c));
+
+		if (dec.satMode != 0) {
+			int32_t lo = (dec.satMode == 1)? JIT_CONST_ZERO : JIT_CONST_MINUS_ONE;
+
+			EmitLoad(2, JIT_BASE_CONST, JIT_CONST_ONE);
+			EmitCmp(2, 0, CMP_LT);						// v > hi
+			EmitLoad(3, JIT_BASE_CONST, JIT_CONST_ONE);
+			EmitRR(false, SSE_ANDPS, 3, 2);
+			EmitRR(false, SSE_ANDNPS, 2, 0);
+			EmitRR(false, SSE_ORPS, 2, 3);
+			EmitRR(false, SSE_MOVAPS, 4, 0);
+			EmitLoad(5, JIT_BASE_CONST, lo);
+			EmitCmp(4, 5, CMP_LT);						// v < lo
+			EmitRR(false, SSE_ANDPS, 5, 4);
+			EmitRR(false, SSE_ANDNPS, 4, 2);
+			EmitRR(false, SSE_ORPS, 4, 5);
+		}
+		else
+			EmitRR(false, SSE_MOVAPS, 4, 0);
+
+		if (dec.dstType == INST_ATTRIB)
+			EmitStore(4, RF_DST(c)); // Scattered by ShaderCore::JitScatter()
+		else if (dec.dstID >= 0)
+			EmitBlend(4, RF_REG(dec.dstID, c));
+
+		if (dec.ccID >= 0) {
+			EmitLoad(1, JIT_BASE_CONST, JIT_CONST_ZERO);
+			EmitLoad(3, JIT_BASE_CONST, JIT_CONST_ONE);
+			EmitRR(false, SSE_MOVAPS, 2, 0);
+			EmitCmp(2, 1, CMP_LT);
+			EmitRR(false, SSE_ANDPS, 2, 3);
+			EmitBlend(2, RF_CCSIGNED(dec.ccID, c));
+			EmitRR(false, SSE_MOVAPS, 2, 0);
+			EmitCmp(2, 1, CMP_EQ);
+			EmitRR(false, SSE_ANDPS, 2, 3);
+			EmitBlend(2, RF_CCZERO(dec.ccID, c));
+		}
+	}
+}
+
+void ShaderJIT::Emit32(int32_t v)
+{
+	for (int i=0; i<4; i++)
+		Emit((uint8_t)(v >> (i*8)));
+}
+
+/// op xmm(reg), xmm(rm)
+void ShaderJIT::EmitRR(bool prefix66, uint8_t op, int reg, int rm)
+{
+	uint8_t rex = 0x40 | ((reg >> 3) << 2) | (rm >> 3);
+
+	if (prefix66)
+		Emit(0x66);
+	if (rex != 0x40)
+		Emit(rex);
+	Emit(0x0f);
+	Emit(op);
+	Emit(0xc0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+/// movups xmm, [base + disp32]
+void ShaderJIT::EmitLoad(int xmm, int base, int32_t disp)
+{
+	if (xmm >= 8)
+		Emit(0x44);
+	Emit(0x0f);
+	Emit(0x10);
+	if (base == JIT_BASE_RF) {
+		Emit(0x84 | ((xmm & 7) << 3));
+		Emit(0x0f); // SIB: rdi + rcx
+	}
+	else
+		Emit(0x86 | ((xmm & 7) << 3)); // rsi
+	Emit32(disp);
+}
+
+/// movups [rdi + rcx + disp32], xmm
+void ShaderJIT::EmitStore(int xmm, int32_t disp)
+{
+	if (xmm >= 8)
+		Emit(0x44);
+	Emit(0x0f);
+	Emit(0x11);
+	Emit(0x84 | ((xmm & 7) << 3));
+	Emit(0x0f);
+	Emit32(disp);
+}
+
+/// cmpps xmm(reg), xmm(rm), pred
+void ShaderJIT::EmitCmp(int reg, int rm, uint8_t pred)
+{
+	EmitRR(false, SSE_CMPPS, reg, rm);
+	Emit(pred);
+}
+
+/// Load component @a c of source @a k into @a xmm, xmm6 is clobbered.
+void ShaderJIT::LoadSrc(const decodedOperand &opnd, int pc, int k, int c, int xmm)
+{
+	switch (opnd.type) {
+	case INST_ATTRIB:
+		EmitLoad(xmm, JIT_BASE_RF, RF_ATTR(opnd.id, opnd.comp[c]));
+		break;
+	case INST_REG:
+		EmitLoad(xmm, JIT_BASE_RF, RF_REG(opnd.id, opnd.comp[c]));
+		break;
+	case INST_CONSTANT:
+		EmitLoad(xmm, JIT_BASE_CONST, constOffset[pc*3 + k] + c*16);
+		break;
+	case INST_CCREG: // The modifiers apply to CCisSigned, see ShaderCore::FetchData().
+		EmitLoad(xmm, JIT_BASE_RF, RF_CCSIGNED(opnd.id, opnd.comp[c]));
+		break;
+	}
+
+	if (opnd.inverse) {
+		EmitLoad(6, JIT_BASE_CONST, JIT_CONST_SIGN);
+		EmitRR(false, SSE_XORPS, xmm, 6);
+	}
+
+	if (opnd.abs) {
+		EmitLoad(6, JIT_BASE_CONST, JIT_CONST_SIGN);
+		EmitRR(false, SSE_ANDNPS, 6, xmm);
+		EmitRR(false, SSE_MOVAPS, xmm, 6);
+	}
+}
+
+/// shufps xmm, xmm, imm
+void ShaderJIT::EmitShuffle(int xmm, uint8_t imm)
+{
+	EmitRR(false, SSE_SHUFPS, xmm, xmm);
+	Emit(imm);
+}
+
+/// Store xmm15 ? new : old into [rdi + rcx + disp32], xmm5-7 are clobbered.
+void ShaderJIT::EmitBlend(int newXmm, int32_t disp)
+{
+	EmitLoad(5, JIT_BASE_RF, disp);
+	EmitRR(false, SSE_MOVAPS, 6, 15);
+	EmitRR(false, SSE_ANDPS, 6, newXmm);
+	EmitRR(false, SSE_MOVAPS, 7, 15);
+	EmitRR(false, SSE_ANDNPS, 7, 5);
+	EmitRR(false, SSE_ORPS, 6, 7);
+	EmitStore(6, disp);
+}
+
+/// Start a loop over the 4-lane groups: xor ecx, ecx
+size_t ShaderJIT::EmitLoopBegin()
+{
+	Emit(0x31); Emit(0xc9);
+	return code.size();
+}
+
+/// Close a loop over the 4-lane groups started at @a loopStart.
+void ShaderJIT::EmitLoopEnd(size_t loopStart)
+{
+	Emit(0x48); Emit(0x83); Emit(0xc1); Emit(0x10); // add rcx, 16
+	Emit(0x48); Emit(0x39); Emit(0xd1); // cmp rcx, rdx
+	EmitJumpTo(JCC_JB, loopStart);
+}
+
+/// Forward jcc rel32, @return Position of rel32 for PatchJump()
+size_t ShaderJIT::EmitJump(uint8_t cond)
+{
+	Emit(0x0f);
+	Emit(cond);
+	Emit32(0);
+	return code.size() - 4;
+}
+
+/// jcc rel32 to @a target
+void ShaderJIT::EmitJumpTo(uint8_t cond, size_t target)
+{
+	Emit(0x0f);
+	Emit(cond);
+	Emit32((int32_t)target - (int32_t)(code.size() + 4));
+}
+
+/// Let the jump emitted by EmitJump() land on the current position.
+void ShaderJIT::PatchJump(size_t at)
+{
+	int32_t rel = (int32_t)code.size() - (int32_t)(at + 4);
+
+	for (int i=0; i<4; i++)
+		code[at + i] = (uint8_t)(rel >> (i*8));
+}
+
+/// Call @a func(core, pc) and restore the arguments it may clobber.
+void ShaderJIT::EmitCall(callback func, int pc)
+{
+	uint64_t addr = (uint64_t)func;
+
+	Emit(0x48); Emit(0x89); Emit(0xdf);	// mov rdi, rbx
+	Emit(0xbe); Emit32(pc);				// mov esi, imm32
+	Emit(0x48); Emit(0xb8);				// mov rax, imm64
+	for (int i=0; i<8; i++)
+		Emit((uint8_t)(addr >> (i*8)));
+	Emit(0xff); Emit(0xd0);				// call rax
+	Emit(0x4c); Emit(0x89); Emit(0xe7);	// mov rdi, r12
+	Emit(0x4c); Emit(0x89); Emit(0xee);	// mov rsi, r13
+	Emit(0x4c); Emit(0x89); Emit(0xf2);	// mov rdx, r14
+}
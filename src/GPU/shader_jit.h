@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2013, Liou Jhe-Yu <lioujheyu@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ *	@file shader_jit.h
+ *  @brief ShaderJIT class
+ */
+
+#ifndef SHADER_JIT_H_INCLUDED
+#define SHADER_JIT_H_INCLUDED
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+
+#include "shader_core.h"
+
+/**
+ *	@brief Native x86-64 code of a linked shader program
+ *
+ *	The program is translated into SSE functions working on the SoA register
+ *	file, normally one function for the whole program. A run of ALU
+ *	instructions is one loop over the lanes, 4 lanes (one quad) per iteration,
+ *	so DDX/DDY are shuffles inside the quad. Every other instruction loops over
+ *	all lanes by itself, which keeps texture accesses in the same order as the
+ *	interpreter:
+ *	- IF/ELSE/ENDIF update per-lane condition masks kept in the register file,
+ *	  and the following code runs under those masks. Both sides of a branch
+ *	  are still run, as the interpreter also executes the instructions of
+ *	  lanes whose condition is false and counts their work.
+ *	- REP/ENDREP are a native loop counted by lane 0.
+ *	- KIL updates a per-lane kill mask natively and calls back into
+ *	  ShaderCore to reclassify the lanes.
+ *	- TEX/TXL/TXD/TXF fetch their operands and texture scale factors natively
+ *	  and call ShaderCore::JitTexture() to sample the texture unit.
+ *	- Output attributes are scattered to the threads by ShaderCore::JitScatter().
+ *	- Opcodes without an exact SSE2 form (floor, round, pow...) are run by the
+ *	  SoA interpreter through ShaderCore::JitInterpret() without leaving the
+ *	  native code.
+ *	Only flow control which does not nest properly or nests deeper than
+ *	SHADER_JIT_MAX_NEST, and IF/KIL on an unsupported condition, are left to
+ *	ShaderCore. The statistic is counted per lane by the native code exactly as
+ *	the interpreter counts it. The code is compiled once at link time and kept
+ *	in the program object.
+ *
+ *	Uniform values are not compiled into the code. Every constant operand reads
+ *	its folded value from a constant table which is refilled by FillConstant()
+ *	for each draw command.
+ */
+class ShaderJIT
+{
+public:
+	typedef void (*segmentFunc)(soaRegFile *rf, const float *constTable,
+								long laneBytes, ShaderCore *core);
+
+	/// A compiled range of instructions
+	struct segment
+	{
+		int start, end; ///< PC range [start, end)
+		segmentFunc func;
+	};
+
+/**
+ *	@param inst		Instruction pool.
+ *	@param instCnt	Program length.
+ *	@param runLane	LANE_* class of each instruction from HelperLaneAnalysis(),
+ *					nullptr if every lane runs everything.
+ */
+	ShaderJIT(const instruction *inst, int instCnt, const int *runLane = nullptr);
+	~ShaderJIT();
+	ShaderJIT(const ShaderJIT&) = delete;
+	ShaderJIT& operator=(const ShaderJIT&) = delete;
+
+/**
+ *	@return The segment starting at @a pc, or nullptr if the instruction is
+ *	interpreted.
+ */
+	inline const segment * SegmentAt(int pc) const
+	{
+		return (segIdx[pc] < 0)? nullptr : &seg[segIdx[pc]];
+	}
+
+	/// Float count of the constant table
+	inline int ConstSize() const { return constSize; }
+
+/**
+ *	Write the folded constant operands of a decoded program into a constant
+ *	table of ConstSize() floats.
+ */
+	void FillConstant(const decodedInst *dec, float *table) const;
+
+	inline int InstCount() const { return (int)segIdx.size(); }
+	inline int NativeInstCount() const { return nativeInstCnt; }
+
+private:
+	typedef void (*callback)(ShaderCore *core, int pc);
+
+	std::vector<segment> seg;
+	std::vector<int> segIdx; ///< Segment index starting at each PC, or -1
+	std::vector<int> constOffset; ///< Table offset of each pc*3+src, or -1
+	std::vector<std::pair<int, int32_t> > literal; ///< Table offset and value of integer constants
+	int constSize;
+	int nativeInstCnt;
+
+	std::vector<uint8_t> code;
+	void *execMem;
+	size_t execSize;
+
+	/// @name Translation
+	///@{
+	void EmitSegment(const instruction *inst, const decodedInst *dec,
+					 const int *kind, const int *lane, const int *slot,
+					 int start, int end);
+	void EmitRun(const instruction *inst, const decodedInst *dec, int lane,
+				 int start, int end);
+	void EmitTexture(const instruction &in, const decodedInst &dec, int lane, int pc);
+	void EmitFlow(const instruction &in, const decodedInst &dec, int lane,
+				  int slot, int pc, std::vector<size_t> &loopStart);
+	void EmitKill(const instruction &in, const decodedInst &dec, int lane, int pc);
+	void EmitCompute(const decodedInst &dec, int op, int pc);
+	void EmitWriteBack(const decodedInst &dec);
+	void EmitMask(int lane, int instCnt, int writeCnt, int laneOpCnt, bool attrOut);
+	void EmitCondition(const instruction &in, const decodedInst &dec);
+	void AllocConst(const decodedInst &dec, int pc);
+	int Literal(int32_t v);
+	///@}
+
+	/// @name x86-64 SSE emitter
+	///@{
+	void Emit(uint8_t b) { code.push_back(b); }
+	void Emit32(int32_t v);
+	void EmitRR(bool prefix66, uint8_t op, int reg, int rm);
+	void EmitLoad(int xmm, int base, int32_t disp);
+	void EmitStore(int xmm, int32_t disp);
+	void EmitCmp(int reg, int rm, uint8_t pred);
+	void EmitShuffle(int xmm, uint8_t imm);
+	void LoadSrc(const decodedOperand &opnd, int pc, int k, int c, int xmm);
+	void EmitBlend(int newXmm, int32_t disp);
+	size_t EmitLoopBegin();
+	void EmitLoopEnd(size_t loopStart);
+	size_t EmitJump(uint8_t cond);
+	void EmitJumpTo(uint8_t cond, size_t target);
+	void PatchJump(size_t at);
+	void EmitCall(callback func, int pc);
+	///@}
+};
+
+#endif // SHADER_JIT_H_INCLUDED
@@ -0,0 +1,160 @@
+/*
+ * Copyright (c) 2013, Liou Jhe-Yu <lioujheyu@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+/**
+ *	@file simd_lane.h
+ *  @brief Host SIMD lane vector primitives
+ *
+ *	A lanef holds SHADER_SOA_WIDTH floats, one per lane, and a lanem holds the
+ *	result of a lane compare. They are shared by the SoA shader engine and the
+ *	scan rasterizer.
+ */
+
+#ifndef SIMD_LANE_H_INCLUDED
+#define SIMD_LANE_H_INCLUDED
+
+#include <algorithm>
+#include <cmath>
+
+#include "../common.h"
+
+/**
+ *	@def SHADER_SOA_WIDTH
+ *	How many lanes the SoA engine executes with one host SIMD instruction.
+ */
+#if defined(__AVX512F__)
+#	define SHADER_SOA_WIDTH 16
+#elif defined(__AVX__)
+#	define SHADER_SOA_WIDTH 8
+#elif defined(USE_SSE)
+#	define SHADER_SOA_WIDTH 4
+#else
+#	define SHADER_SOA_WIDTH 1
+#endif
+
+#if SHADER_SOA_WIDTH == 16
+typedef __m512 lanef;
+typedef __mmask16 lanem;
+
+static inline lanef laneLoad(const float *p) { return _mm512_loadu_ps(p); }
+static inline void laneStore(float *p, lanef v) { _mm512_storeu_ps(p, v); }
+static inline lanef laneSet(float v) { return _mm512_set1_ps(v); }
+static inline lanef laneAdd(lanef a, lanef b) { return _mm512_add_ps(a, b); }
+static inline lanef laneSub(lanef a, lanef b) { return _mm512_sub_ps(a, b); }
+static inline lanef laneMul(lanef a, lanef b) { return _mm512_mul_ps(a, b); }
+static inline lanef laneDiv(lanef a, lanef b) { return _mm512_div_ps(a, b); }
+static inline lanef laneMax(lanef a, lanef b) { return _mm512_max_ps(a, b); }
+static inline lanef laneMin(lanef a, lanef b) { return _mm512_min_ps(a, b); }
+static inline lanem laneLt(lanef a, lanef b) { return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ); }
+static inline lanem laneLe(lanef a, lanef b) { return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ); }
+static inline lanem laneGt(lanef a, lanef b) { return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ); }
+static inline lanem laneGe(lanef a, lanef b) { return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ); }
+static inline lanem laneEq(lanef a, lanef b) { return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ); }
+static inline lanem laneNe(lanef a, lanef b) { return _mm512_cmp_ps_mask(a, b, _CMP_NEQ_UQ); }
+static inline lanef laneSel(lanem m, lanef a, lanef b) { return _mm512_mask_blend_ps(m, b, a); }
+static inline lanef laneNeg(lanef a)
+{
+	return _mm512_castsi512_ps(_mm512_xor_epi32(_mm512_castps_si512(a),
+												_mm512_set1_epi32(0x80000000)));
+}
+static inline lanef laneAbs(lanef a)
+{
+	return _mm512_castsi512_ps(_mm512_and_epi32(_mm512_castps_si512(a),
+												_mm512_set1_epi32(0x7fffffff)));
+}
+#elif SHADER_SOA_WIDTH == 8
+typedef __m256 lanef;
+typedef __m256 lanem;
+
+static inline lanef laneLoad(const float *p) { return _mm256_loadu_ps(p); }
+static inline void laneStore(float *p, lanef v) { _mm256_storeu_ps(p, v); }
+static inline lanef laneSet(float v) { return _mm256_set1_ps(v); }
+static inline lanef laneAdd(lanef a, lanef b) { return _mm256_add_ps(a, b); }
+static inline lanef laneSub(lanef a, lanef b) { return _mm256_sub_ps(a, b); }
+static inline lanef laneMul(lanef a, lanef b) { return _mm256_mul_ps(a, b); }
+static inline lanef laneDiv(lanef a, lanef b) { return _mm256_div_ps(a, b); }
+static inline lanef laneMax(lanef a, lanef b) { return _mm256_max_ps(a, b); }
+static inline lanef laneMin(lanef a, lanef b) { return _mm256_min_ps(a, b); }
+static inline lanem laneLt(lanef a, lanef b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+static inline lanem laneLe(lanef a, lanef b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+static inline lanem laneGt(lanef a, lanef b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+static inline lanem laneGe(lanef a, lanef b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+static inline lanem laneEq(lanef a, lanef b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+static inline lanem laneNe(lanef a, lanef b) { return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ); }
+static inline lanef laneSel(lanem m, lanef a, lanef b) { return _mm256_blendv_ps(b, a, m); }
+static inline lanef laneNeg(lanef a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+static inline lanef laneAbs(lanef a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+#elif SHADER_SOA_WIDTH == 4
+typedef __m128 lanef;
+typedef __m128 lanem;
+
+static inline lanef laneLoad(const float *p) { return _mm_loadu_ps(p); }
+static inline void laneStore(float *p, lanef v) { _mm_storeu_ps(p, v); }
+static inline lanef laneSet(float v) { return _mm_set1_ps(v); }
+static inline lanef laneAdd(lanef a, lanef b) { return _mm_add_ps(a, b); }
+static inline lanef laneSub(lanef a, lanef b) { return _mm_sub_ps(a, b); }
+static inline lanef laneMul(lanef a, lanef b) { return _mm_mul_ps(a, b); }
+static inline lanef laneDiv(lanef a, lanef b) { return _mm_div_ps(a, b); }
+static inline lanef laneMax(lanef a, lanef b) { return _mm_max_ps(a, b); }
+static inline lanef laneMin(lanef a, lanef b) { return _mm_min_ps(a, b); }
+static inline lanem laneLt(lanef a, lanef b) { return _mm_cmplt_ps(a, b); }
+static inline lanem laneLe(lanef a, lanef b) { return _mm_cmple_ps(a, b); }
+static inline lanem laneGt(lanef a, lanef b) { return _mm_cmpgt_ps(a, b); }
+static inline lanem laneGe(lanef a, lanef b) { return _mm_cmpge_ps(a, b); }
+static inline lanem laneEq(lanef a, lanef b) { return _mm_cmpeq_ps(a, b); }
+static inline lanem laneNe(lanef a, lanef b) { return _mm_cmpneq_ps(a, b); }
+static inline lanef laneSel(lanem m, lanef a, lanef b)
+{
+	return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+}
+static inline lanef laneNeg(lanef a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+static inline lanef laneAbs(lanef a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+#else
+typedef float lanef;
+typedef bool lanem;
+
+static inline lanef laneLoad(const float *p) { return *p; }
+static inline void laneStore(float *p, lanef v) { *p = v; }
+static inline lanef laneSet(float v) { return v; }
+static inline lanef laneAdd(lanef a, lanef b) { return a + b; }
+static inline lanef laneSub(lanef a, lanef b) { return a - b; }
+static inline lanef laneMul(lanef a, lanef b) { return a * b; }
+static inline lanef laneDiv(lanef a, lanef b) { return a / b; }
+static inline lanef laneMax(lanef a, lanef b) { return std::max(a, b); }
+static inline lanef laneMin(lanef a, lanef b) { return std::min(a, b); }
+static inline lanem laneLt(lanef a, lanef b) { return a < b; }
+static inline lanem laneLe(lanef a, lanef b) { return a <= b; }
+static inline lanem laneGt(lanef a, lanef b) { return a > b; }
+static inline lanem laneGe(lanef a, lanef b) { return a >= b; }
+static inline lanem laneEq(lanef a, lanef b) { return a == b; }
+static inline lanem laneNe(lanef a, lanef b) { return a != b; }
+static inline lanef laneSel(lanem m, lanef a, lanef b) { return m ? a : b; }
+static inline lanef laneNeg(lanef a) { return -a; }
+static inline lanef laneAbs(lanef a) { return fabs(a); }
+#endif
+
+/// Bit i is set if lane i of @a m is true.
+#if SHADER_SOA_WIDTH == 16
+static inline int laneBits(lanem m) { return (int)m; }
+#elif SHADER_SOA_WIDTH == 8
+static inline int laneBits(lanem m) { return _mm256_movemask_ps(m); }
+#elif SHADER_SOA_WIDTH == 4
+static inline int laneBits(lanem m) { return _mm_movemask_ps(m); }
+#else
+static inline int laneBits(lanem m) { return m ? 1 : 0; }
+#endif
+
+#endif // SIMD_LANE_H_INCLUDED
@@ -22,15 +22,17 @@
 
 #include "texture_unit.h"
 
-void TextureUnit::ClearTexCache()
+void textureCache::Clear()
 {
 	for(int i=0; i<TEX_CACHE_ENTRY_SIZE; i++) {
-		TexCache.valid[i][0] =
-		TexCache.valid[i][1] =
-		TexCache.valid[i][2] =
-		TexCache.valid[i][3] = false;
-		TexCache.RRFlag[i] = 0;
+		for (int w=0; w<TEX_WAY_ASSOCIATION; w++)
+			valid[i][w] = false;
+		RRFlag[i] = 0;
 	}
+}
+
+void TextureUnit::ClearStat()
+{
 	hit = 0;
 	miss = 0;
 	coldMiss = 0;
@@ -85,7 +87,7 @@ floatVec4 TextureUnit::GetTexColor(const floatVec4 &coordIn, int level, int tid)
 	texTmpPtr = targetImage->data[level] +
 				(v*targetImage->widthLevel[level] + u)*4;
 
-	dram->LocalAccess(false, (size_t)texTmpPtr, tmpData, 4, 1);
+	cache->dram.LocalAccess(false, (size_t)texTmpPtr, tmpData, 4, 1);
 	color.r = (float)(tmpData&0xff)/255;
 	color.g = (float)((tmpData>>8)&0xff)/255;
 	color.b = (float)((tmpData>>16)&0xff)/255;
@@ -100,6 +102,7 @@ floatVec4 TextureUnit::GetTexColor(const floatVec4 &coordIn, int level, int tid)
 	uint16_t entry, offset, U_Block, V_Block, U_Offset, V_Offset, U_Super, V_Super;
 	uint8_t tWay = 0;
     bool isColdMiss = false;
+	uint32_t lineData[TEX_CACHE_BLOCK_SIZE];
 
 /**
  *	While level image size is smaller than cache block size, the 6D texture
@@ -154,11 +157,11 @@ floatVec4 TextureUnit::GetTexColor(const floatVec4 &coordIn, int level, int tid)
 	}
 
 	for (i=0; i<TEX_WAY_ASSOCIATION; i++) {
-		if (TexCache.valid[entry][i] == true) {
-			if (TexCache.tag[entry][i] == tag) {
+		if (cache->valid[entry][i] == true) {
+			if (cache->tag[entry][i] == tag) {
 			//*************** Texture cache hit *************
 				hit++;
-				return TexCache.color[entry][offset][i];
+				return cache->color[entry][offset][i];
 			}
 		}
 		else
@@ -168,12 +171,13 @@ floatVec4 TextureUnit::GetTexColor(const floatVec4 &coordIn, int level, int tid)
 	//*********** Texture cache miss ****************
 	miss++;
 
-	tWay = TexCache.RRFlag[entry] % TEX_WAY_ASSOCIATION;
-	TexCache.RRFlag[entry]++;
-	TexCache.tag[entry][tWay] = tag;
+	tWay = cache->RRFlag[entry] % TEX_WAY_ASSOCIATION;
+	cache->RRFlag[entry]++;
+	cache->tag[entry][tWay] = tag;
+
+	if (cache->valid[entry][tWay] == false)
+		cache->valid[entry][tWay] = true;
 
-	if (TexCache.valid[entry][tWay] == false)
-		TexCache.valid[entry][tWay] = true;
 #	ifdef IMAGE_MEMORY_OPTIMIZE
 	if (targetImage->heightLevel[level] >= TEX_CACHE_BLOCK_SIZE_ROOT)
 		texTmpPtr = targetImage->data[level] +
@@ -182,54 +186,45 @@ floatVec4 TextureUnit::GetTexColor(const floatVec4 &coordIn, int level, int tid)
 	else //targetImage->heightLevel[levelCount] < TEX_CACHE_BLOCK_SIZE_ROOT
 		texTmpPtr = targetImage->data[(targetImage->maxLevel - TEX_CACHE_BLOCK_SIZE_ROOT_LOG)&0xf];
 
+	cache->dram.BurstAccess(false, (size_t)texTmpPtr, lineData, TEX_CACHE_BLOCK_SIZE);
 	for (i=0; i<TEX_CACHE_BLOCK_SIZE; i++) {
-		if (TEX_CACHE_BLOCK_SIZE > 16) // Limit maximum burst length to 16
-			dram->LocalAccess(false, (size_t)texTmpPtr+i*4, tmpData, 4, 16-(i&0xf));
-		else
-			dram->LocalAccess(false, (size_t)texTmpPtr+i*4, tmpData, 4, TEX_CACHE_BLOCK_SIZE-i);
-		TexCache.color[entry][i][tWay].r = (float)(tmpData&0xff)/255;
-		TexCache.color[entry][i][tWay].g = (float)((tmpData>>8)&0xff)/255;
-		TexCache.color[entry][i][tWay].b = (float)((tmpData>>16)&0xff)/255;
-		TexCache.color[entry][i][tWay].a = (float)((tmpData>>24)&0xff)/255;
+		tmpData = lineData[i];
+		cache->color[entry][i][tWay].r = (float)(tmpData&0xff)/255;
+		cache->color[entry][i][tWay].g = (float)((tmpData>>8)&0xff)/255;
+		cache->color[entry][i][tWay].b = (float)((tmpData>>16)&0xff)/255;
+		cache->color[entry][i][tWay].a = (float)((tmpData>>24)&0xff)/255;
 	}
 #	else
     if (targetImage->heightLevel[level] >= TEX_CACHE_BLOCK_SIZE_ROOT) {
 		for (j=0; j<TEX_CACHE_BLOCK_SIZE_ROOT; j++) {
+			texTmpPtr = targetImage->data[level] +
+						CalcTexAdd(U_Super,U_Block,0,
+								V_Super,V_Block,j,
+								targetImage->widthLevel[level]) * 4;
+			cache->dram.BurstAccess(false, (size_t)texTmpPtr, lineData, TEX_CACHE_BLOCK_SIZE_ROOT);
 			for (i=0; i<TEX_CACHE_BLOCK_SIZE_ROOT; i++) {
-				texTmpPtr = targetImage->data[level] +
-							CalcTexAdd(U_Super,U_Block,i,
-									V_Super,V_Block,j,
-									targetImage->widthLevel[level]) * 4;
-				if (TEX_CACHE_BLOCK_SIZE_ROOT > 16) // Limit maximum burst length to 16
-					dram->LocalAccess(false, (size_t)texTmpPtr, tmpData, 4, 16-(i&0xf));
-				else
-					dram->LocalAccess(false, (size_t)texTmpPtr, tmpData, 4, TEX_CACHE_BLOCK_SIZE_ROOT-i);
-//				dram->LocalAccess(false, (size_t)texTmpPtr, tmpData, 4, 1);
-				TexCache.color[entry][j*TEX_CACHE_BLOCK_SIZE_ROOT+i][tWay].r =
+				tmpData = lineData[i];
+				cache->color[entry][j*TEX_CACHE_BLOCK_SIZE_ROOT+i][tWay].r =
 					(float)(tmpData&0xff)/255;
-				TexCache.color[entry][j*TEX_CACHE_BLOCK_SIZE_ROOT+i][tWay].g =
+				cache->color[entry][j*TEX_CACHE_BLOCK_SIZE_ROOT+i][tWay].g =
 					(float)((tmpData>>8)&0xff)/255;
-				TexCache.color[entry][j*TEX_CACHE_BLOCK_SIZE_ROOT+i][tWay].b =
+				cache->color[entry][j*TEX_CACHE_BLOCK_SIZE_ROOT+i][tWay].b =
 					(float)((tmpData>>16)&0xff)/255;
-				TexCache.color[entry][j*TEX_CACHE_BLOCK_SIZE_ROOT+i][tWay].a =
+				cache->color[entry][j*TEX_CACHE_BLOCK_SIZE_ROOT+i][tWay].a =
 					(float)((tmpData>>24)&0xff)/255;
-
-				texTmpPtr+=4;
 			}
 		}
     }
     else { //targetImage->heightLevel[levelCount] < TEX_CACHE_BLOCK_SIZE_ROOT
 		texTmpPtr = targetImage->data[(targetImage->maxLevel - TEX_CACHE_BLOCK_SIZE_ROOT_LOG)&0xf];
 
+		cache->dram.BurstAccess(false, (size_t)texTmpPtr, lineData, TEX_CACHE_BLOCK_SIZE);
 		for (i=0; i<TEX_CACHE_BLOCK_SIZE; i++) {
-			if (TEX_CACHE_BLOCK_SIZE > 16) // Limit maximum burst length to 16
-				dram->LocalAccess(false, (size_t)texTmpPtr+i*4, tmpData, 4, 16-(i&0xf));
-			else
-				dram->LocalAccess(false, (size_t)texTmpPtr+i*4, tmpData, 4, TEX_CACHE_BLOCK_SIZE-i);
-			TexCache.color[entry][i][tWay].r = (float)(tmpData&0xff)/255;
-			TexCache.color[entry][i][tWay].g = (float)((tmpData>>8)&0xff)/255;
-			TexCache.color[entry][i][tWay].b = (float)((tmpData>>16)&0xff)/255;
-			TexCache.color[entry][i][tWay].a = (float)((tmpData>>24)&0xff)/255;
+			tmpData = lineData[i];
+			cache->color[entry][i][tWay].r = (float)(tmpData&0xff)/255;
+			cache->color[entry][i][tWay].g = (float)((tmpData>>8)&0xff)/255;
+			cache->color[entry][i][tWay].b = (float)((tmpData>>16)&0xff)/255;
+			cache->color[entry][i][tWay].a = (float)((tmpData>>24)&0xff)/255;
 		}
     }
 #	endif // IMAGE_MEMORY_OPTIMIZE
@@ -243,7 +238,7 @@ floatVec4 TextureUnit::GetTexColor(const floatVec4 &coordIn, int level, int tid)
 	return floatVec4(0.0, 1.0, 0.0, 1.0);
 #	endif //SHOW_TEXCACHE_MISS
 
-	return TexCache.color[entry][offset][tWay];
+	return cache->color[entry][offset][tWay];
 
 #endif // NO_TEX_CACHE
 }
@@ -59,14 +59,41 @@ const int TEX_CACHE_ENTRY_SIZE_ROOT_LOG = (int)log2(TEX_CACHE_ENTRY_SIZE_ROOT);
 #define CUBE_POS_Y	0x5
 #define CUBE_POS_Z	0x6
 
+/**
+ *	@brief Texture cache structure
+ *
+ *	The whole texture cache size is determined as
+ *	TEX_WAY_ASSOCIATION * TEX_CACHE_BLOCK_SIZE * TEX_CACHE_ENTRY_SIZE * 4B
+ *
+ *	A cache is bound to a TextureUnit rather than owned by it. Each tile worker
+ *	keeps its own cache and DRAM timing view and binds them to whichever
+ *	shader core it acquires, so its misses and memory time do not depend on
+ *	how cores and DRAM are shared with the other workers.
+ */
+struct textureCache {
+	textureCache(const DRAM *storage) : dram(storage) { Clear(); }
+
+	void			Clear();
+
+	bool			valid[TEX_CACHE_ENTRY_SIZE][TEX_WAY_ASSOCIATION];
+	uint32_t		tag[TEX_CACHE_ENTRY_SIZE][TEX_WAY_ASSOCIATION];
+	floatVec4		color[TEX_CACHE_ENTRY_SIZE][TEX_CACHE_BLOCK_SIZE][TEX_WAY_ASSOCIATION];
+	uint8_t			RRFlag[TEX_CACHE_ENTRY_SIZE];
+
+	DRAM			dram; ///< Timing view of the texture memory filling this cache
+};
+
 class TextureUnit {
 public:
-    TextureUnit(DRAM *dram)
+    TextureUnit()
 	{
-		this->dram = dram;
-		ClearTexCache();
+		cache = nullptr;
+		ClearStat();
 	}
 
+	/// Cache and DRAM timing in use, bound before each shader core run
+	textureCache	*cache;
+
 	///@name Texture filtering mode
 	///@{
     GLenum minFilter[MAX_TEXTURE_CONTEXT];
@@ -90,7 +117,7 @@ public:
 	textureImage texCubePY[MAX_TEXTURE_CONTEXT];
 	textureImage texCubePZ[MAX_TEXTURE_CONTEXT];
 
-	void		ClearTexCache();
+	void		ClearStat();
 
 /**
  *	Get the texel's color in the specified texture coordinate. You can toggle
@@ -179,21 +206,6 @@ private:
 	textureImage 	*targetImage;
 	/// image face selection identifier from 2D image or 1 of 6 cube map image;
 	int 			imageSelection;
-
-	/**
-	*	@brief Texture cache structure
-	*
-	*	The whole texture cache size is determined as
-	*	TEX_WAY_ASSOCIATION * TEX_CACHE_BLOCK_SIZE * TEX_CACHE_ENTRY_SIZE * 4B
-	*/
-	struct {
-        bool            valid[TEX_CACHE_ENTRY_SIZE][TEX_WAY_ASSOCIATION];
-        uint32_t	tag[TEX_CACHE_ENTRY_SIZE][TEX_WAY_ASSOCIATION];
-        floatVec4       color[TEX_CACHE_ENTRY_SIZE][TEX_CACHE_BLOCK_SIZE][TEX_WAY_ASSOCIATION];
-		uint8_t	RRFlag[TEX_CACHE_ENTRY_SIZE];
-    }TexCache;
-
-	DRAM *dram;
 };
 
 #endif // TEXTURE_UNIT_H_INCLUDED
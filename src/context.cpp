@@ -29,6 +29,7 @@ Context::Context()
     m_current = false;
     activeTexCtx = 0;
     usePID = 0;
+    dirtyState = DIRTY_ALL;
     drawBuffer[0] = drawBuffer[1] = nullptr;
 
     for (int i=0;i<MAX_ATTRIBUTE_NUMBER;i++)
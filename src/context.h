@@ -31,14 +31,31 @@
 #include <sstream>
 #include <algorithm>
 #include <map>
+#include <memory>
 #include <stack>
 #include <GLES3/gl3.h>
 #include <GLES3/gl2ext.h>
 
 #include "GPU/driver.h"
+#include "GPU/shader_jit.h"
 #include "GPU/gpu_config.h"
 #include "common.h"
 
+/**
+ *	@name State groups of Context::dirtyState
+ *	Each bit marks a group of states which has changed since the last draw
+ *	command, so the driver only passes those groups to the GPU.
+ */
+///@{
+#define DIRTY_VERTEX_ARRAY	0x01 ///< Attribute arrays
+#define DIRTY_PROGRAM		0x02 ///< Program in use and its instruction pools
+#define DIRTY_UNIFORM		0x04 ///< Uniform values
+#define DIRTY_VIEWPORT		0x08 ///< Viewport and depth range
+#define DIRTY_RASTER		0x10 ///< Culling, blending and depth test
+#define DIRTY_TEXTURE		0x20 ///< Sampler bindings and texture parameters
+#define DIRTY_ALL			0x3f
+///@}
+
 struct attribute
 {
     attribute()
@@ -92,6 +109,24 @@ struct textureObject
 	textureImage	texCubeNX, texCubePX;
 	textureImage	texCubeNY, texCubePY;
 	textureImage	texCubeNZ, texCubePZ;
+
+/**
+ *	@name DRAM residency
+ *	The driver uploads a texture object into the GPU's DRAM on its first draw
+ *	and keeps it there. dramImage[] are the images above, in the order of
+ *	texFace[] in driver.cpp, with data[] holding device addresses. They are
+ *	uploaded again only after TexImage2D or GenerateMipmap sets dirty. The
+ *	least recently drawn textures are evicted when DRAM is full.
+ */
+///@{
+	bool			dirty;
+	uint32_t		dramAddr;
+	uint32_t		dramSize; ///< Bytes reserved at dramAddr, 0 if not resident
+	uint32_t		lastDraw; ///< Last draw command using it, for eviction
+	textureImage	dramImage[7];
+///@}
+
+	inline textureObject() : dirty(true), dramAddr(0), dramSize(0), lastDraw(0) {}
 };
 
 struct textureContext
@@ -233,6 +268,14 @@ struct programObject
 	std::vector<instruction> FSinstructionPool;
 ///@}
 
+	/// Native code of the instruction pools, compiled at link time
+	std::shared_ptr<ShaderJIT> VSjit, FSjit;
+
+	/// LANE_* class running each FS instruction, see HelperLaneAnalysis()
+	std::vector<int> FSrunLane;
+	/// Attribute components the FS needs, see AttribReadMask()
+	unsigned int FSattrRead;
+
 	inline programObject()
 	{
 		sid4VS = 0;
@@ -251,6 +294,7 @@ struct programObject
 		FSuniformCnt = 0;
 		uniformCnt = 0;
 		texCnt = 0;
+		FSattrRead = 0;
 	}
 
 	/// Initialize the members which is related for program linkage
@@ -279,6 +323,10 @@ struct programObject
 		asmUniformFSIdx.clear();
 		VSinstructionPool.clear();
 		FSinstructionPool.clear();
+		VSjit.reset();
+		FSjit.reset();
+		FSrunLane.clear();
+		FSattrRead = 0;
 	}
 };
 
@@ -398,6 +446,9 @@ public:
 	///The Program ID prepared for using.
     GLuint			usePID;
 
+	/// DIRTY_* groups changed since the last draw command, cleared by the driver
+	uint32_t		dirtyState;
+
 ///@name Object Pool
 ///@{
 /**
@@ -53,6 +53,7 @@ void Context::BindTexture(GLenum target, GLuint texture)
 	}
 
 	texCtx[activeTexCtx].texObjBindID = texture;
+	dirtyState |= DIRTY_TEXTURE;
 }
 
 void Context::Clear(GLbitfield mask)
@@ -82,6 +83,7 @@ void Context::ClearDepthf (GLfloat depth)
 void Context::CullFace(GLenum mode)
 {
 	cullFaceMode = mode;
+	dirtyState |= DIRTY_RASTER;
 }
 
 void Context::DeleteTextures(GLsizei n, const GLuint *textures)
@@ -95,6 +97,8 @@ void Context::DeleteTextures(GLsizei n, const GLuint *textures)
         if (texObjPool.find(*(textures+i)) == texObjPool.end())
 			continue;
 
+		ReleaseTexture(&texObjPool[*(textures+i)]);
+
         for (int l=0;l<=texObjPool[*(textures+i)].tex2D.maxLevel;l++)
 			delete[] texObjPool[*(textures+i)].tex2D.data[l];
 
@@ -126,6 +130,7 @@ void Context::DepthRangef(GLfloat n, GLfloat f)
 {
     vp.n = (n<0)?0:(n>1)?1:n;
     vp.f = (f<0)?0:(f>1)?1:f;
+    dirtyState |= DIRTY_VIEWPORT;
 }
 
 void Context::Disable(GLenum cap)
@@ -159,6 +164,7 @@ void Context::Disable(GLenum cap)
         RecordError(GL_INVALID_VALUE);
         return;
     }
+    dirtyState |= DIRTY_RASTER;
 }
 
 ///DrawArrays will also call driver to active GPU for drawing.
@@ -281,6 +287,7 @@ void Context::Enable(GLenum cap)
         RecordError(GL_INVALID_ENUM);
         return;
     }
+    dirtyState |= DIRTY_RASTER;
 }
 
 void Context::EnableVertexAttribArray(GLuint index)
@@ -291,11 +298,13 @@ void Context::EnableVertexAttribArray(GLuint index)
     }
 
     vertexAttrib[index].enable = GL_TRUE;
+    dirtyState |= DIRTY_VERTEX_ARRAY;
 }
 
 void Context::FrontFace(GLenum mode)
 {
 	frontFace = mode;
+	dirtyState |= DIRTY_RASTER;
 }
 
 void Context::GenerateMipmap(GLenum target)
@@ -309,7 +318,9 @@ void Context::GenerateMipmap(GLenum target)
 		break;
 	default:
 		RecordError(GL_INVALID_ENUM);
+		return;
 	}
+	dirtyState |= DIRTY_TEXTURE;
 }
 
 /// @note Searching the free texture id under std::map is not efficient.
@@ -507,6 +518,7 @@ void Context::TexImage2D(GLenum target, GLint level, GLint internalformat, GLsiz
     t_image->heightLevel[level] = height;
     t_image->maxLevel = (level>t_image->maxLevel)?level:t_image->maxLevel;
     t_image->data[level] = image;
+    texObjPool[texObjID].dirty = true;
 }
 
 void Context::TexParameteri(GLenum target, GLenum pname, GLint param)
@@ -603,6 +615,7 @@ void Context::TexParameteri(GLenum target, GLenum pname, GLint param)
         RecordError(GL_INVALID_ENUM);
         break;
     }
+	dirtyState |= DIRTY_TEXTURE;
 }
 
 #define SET_UNIFORM_CHECK_PROCEDURE(type)											\
@@ -626,7 +639,8 @@ void Context::TexParameteri(GLenum target, GLenum pname, GLint param)
 	else if (U_PROG.srcUniform[U_PROG.uniformUsage[location]].declareType != type) {\
 		RecordError(GL_INVALID_OPERATION);											\
 		return;																		\
-	}
+	}																				\
+	dirtyState |= DIRTY_UNIFORM;
 
 void Context::Uniform1f (GLint location, GLfloat x)
 {
@@ -673,8 +687,10 @@ void Context::Uniform1i(GLint location, GLint x)
 		location = location - MAX_UNIFORM_VECTORS;
 		if (location >= U_PROG.texCnt)
 			RecordError(GL_INVALID_OPERATION);
-		else
+		else {
 			samplePool[location] = x;
+			dirtyState |= DIRTY_TEXTURE;
+		}
 	}
 	else if (location < 0)
 		RecordError(GL_INVALID_OPERATION);
@@ -683,8 +699,10 @@ void Context::Uniform1i(GLint location, GLint x)
 			RecordError(GL_INVALID_OPERATION);
 		else if (U_PROG.srcUniform[U_PROG.uniformUsage[location]].declareType != "int")
 			RecordError(GL_INVALID_OPERATION);
-		else
+		else {
 			uniformPool[location].x = (float)x;
+			dirtyState |= DIRTY_UNIFORM;
+		}
 	}
 }
 
@@ -795,6 +813,7 @@ void Context::Uniform1iv(GLint location, GLsizei count, const GLint * value)
 		else {
 			for(int i=0; i<count; i++)
 				samplePool[location+i] = *(value + i);
+			dirtyState |= DIRTY_TEXTURE;
 		}
 	}
 	else if (location < 0)
@@ -807,6 +826,7 @@ void Context::Uniform1iv(GLint location, GLsizei count, const GLint * value)
 		else {
 			for(int i=0; i<count; i++)
 				uniformPool[location+i].x = (float)*(value + i);
+			dirtyState |= DIRTY_UNIFORM;
 		}
 	}
 }
@@ -959,6 +979,7 @@ void Context::VertexAttribPointer(GLuint indx, GLint size, GLenum type, GLboolea
     vertexAttrib[indx].normalized = normalized;
     vertexAttrib[indx].stride = stride;
     vertexAttrib[indx].ptr = ptr;
+    dirtyState |= DIRTY_VERTEX_ARRAY;
 }
 
 void Context::Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
@@ -973,6 +994,7 @@ void Context::Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
     vp.y = y;
     vp.w = width;
     vp.h = height;
+    dirtyState |= DIRTY_VIEWPORT;
 
 /// @todo Correct buffer setting after buffer management is ready.
 	if (drawBuffer[0] == nullptr)
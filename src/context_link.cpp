@@ -124,7 +124,20 @@ void Context::LinkProgram(GLuint program)
 	nvgp4ASM_parse();
 
 	programPool[program] = t_program;
+	programPool[program].VSjit = std::make_shared<ShaderJIT>(
+		t_program.VSinstructionPool.data(), (int)t_program.VSinstructionPool.size());
+	programPool[program].FSrunLane.resize(t_program.FSinstructionPool.size());
+	HelperLaneAnalysis(t_program.FSinstructionPool.data(),
+					   (int)t_program.FSinstructionPool.size(),
+					   programPool[program].FSrunLane.data());
+	programPool[program].FSjit = std::make_shared<ShaderJIT>(
+		t_program.FSinstructionPool.data(), (int)t_program.FSinstructionPool.size(),
+		programPool[program].FSrunLane.data());
+	programPool[program].FSattrRead = AttribReadMask(
+		t_program.FSinstructionPool.data(), (int)t_program.FSinstructionPool.size());
 	programPool[program].isLinked = GL_TRUE;
+	if (program == usePID)
+		dirtyState |= DIRTY_PROGRAM | DIRTY_UNIFORM | DIRTY_TEXTURE;
 
 #ifdef ASM_INFO
 	for (unsigned int i=0; i<t_program.VSinstructionPool.size(); i++)
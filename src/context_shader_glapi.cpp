@@ -22,6 +22,72 @@
 
 #include "context.h"
 
+#include <sys/stat.h>
+#ifdef __WIN32__
+#	include <direct.h>
+#	include <process.h>
+#	define getpid _getpid
+#else
+#	include <unistd.h>
+#endif
+
+/**
+ *	Name of the cached assembly for @a src compiled with @a option, a 64-bit
+ *	FNV-1a hash of both. It depends on nothing else, so a cache directory can
+ *	be copied between machines.
+ */
+static std::string ShaderCacheName(const std::string &option, const std::string &src,
+								   const char *ext)
+{
+	uint64_t hash = 0xcbf29ce484222325ull;
+	std::string key = option + '\n' + src;
+
+	for (unsigned char c : key) {
+		hash ^= c;
+		hash *= 0x100000001b3ull;
+	}
+
+	char name[17];
+	snprintf(name, sizeof(name), "%016llx", (unsigned long long)hash);
+	return std::string(SHADER_CACHE_DIR) + "/" + name + ext;
+}
+
+static bool ReadFile(const std::string &fileName, std::string &content)
+{
+	std::ifstream ift(fileName, std::ifstream::in);
+	if (!ift.is_open())
+		return false;
+
+	std::stringstream buffer;
+	buffer << ift.rdbuf();
+	content = buffer.str();
+	return !content.empty();
+}
+
+/**
+ *	Store @a asmSrc under @a cacheName. It is written to a temporary file named
+ *	after the process first and renamed, so concurrent runs neither write the
+ *	same file nor read half of it.
+ */
+static void WriteShaderCache(const std::string &cacheName, const std::string &asmSrc)
+{
+#ifdef __WIN32__
+	_mkdir(SHADER_CACHE_DIR);
+#else
+	mkdir(SHADER_CACHE_DIR, 0777);
+#endif
+
+	std::string tmpName = cacheName + "." + std::to_string((long)getpid()) + ".tmp";
+	FILE *cacheFile = fopen(tmpName.c_str(), "wb");
+	if (cacheFile == nullptr)
+		return;
+
+	bool done = fwrite(asmSrc.data(), 1, asmSrc.size(), cacheFile) == asmSrc.size();
+	done = (fclose(cacheFile) == 0) && done;
+	if (!done || rename(tmpName.c_str(), cacheName.c_str()) != 0)
+		remove(tmpName.c_str());
+}
+
 void Context::AttachShader(GLuint program, GLuint shader)
 {
 	if (shaderPool.find(shader) == shaderPool.end())
@@ -92,10 +158,12 @@ GLint Context::CreateShader(GLenum type)
 /**
  *	@brief Compile source in shaderObject
  *
- *	The procedure will write vertex shader or fragment shader source into
- *	.vssrc or .fssrc file, and then use cgc to compile them and write the
- *	assembly output in .vsasm or .fsasm file. Finally read these asm source
- *	from file as string input back into shader object.
+ *	The NVGP4 assembly is first looked up in \ref SHADER_CACHE_DIR by the hash
+ *	of the source and the compile options. On a miss, the procedure writes
+ *	vertex shader or fragment shader source into .vssrc or .fssrc file, and
+ *	then uses cgc to compile them and write the assembly output in .vsasm or
+ *	.fsasm file. Finally it reads these asm source from file as string input
+ *	back into shader object, and stores a copy in the cache.
  */
 void Context::CompileShader(GLuint shader)
 {
@@ -109,43 +177,51 @@ void Context::CompileShader(GLuint shader)
 
 	FILE *shaderFile;
 
-	std::string fileName, cFileName;
-	std::string compileCmd, fileIdx;
+	std::string fileName, cFileName, cacheName;
+	std::string compileCmd, compileOption, fileIdx;
+	const char *asmExt;
 
 	fileIdx.append(std::to_string((int)shader));
 
 	if (shaderPool[shader].type == GL_VERTEX_SHADER) {
 		fileName = fileIdx + ".vssrc";
-		cFileName = fileIdx + ".vsasm";
+		asmExt = ".vsasm";
+		compileOption = "-q -oglsl -profile gp4vp";
 	}
 	else {
 		fileName = fileIdx + ".fssrc";
-		cFileName = fileIdx + ".fsasm";
+		asmExt = ".fsasm";
+		compileOption = "-q -oglsl -profile gp4fp";
+	}
+	cFileName = fileIdx + asmExt;
+
+	if (strlen(SHADER_CACHE_DIR) > 0) {
+		cacheName = ShaderCacheName(compileOption, shaderPool[shader].src, asmExt);
+		if (ReadFile(cacheName, shaderPool[shader].asmSrc)) {
+			shaderPool[shader].isCompiled = GL_TRUE;
+			return;
+		}
 	}
 
 	shaderFile = fopen(fileName.c_str(),"w");
-	fprintf(shaderFile,shaderPool[shader].src.c_str());
+	fputs(shaderPool[shader].src.c_str(), shaderFile);
 	fclose(shaderFile);
 
-	compileCmd = "cgc -q -oglsl -o ";
-	compileCmd+=cFileName;
-	if (shaderPool[shader].type == GL_VERTEX_SHADER)
-		compileCmd.append(" -profile gp4vp ");
-	else
-		compileCmd.append(" -profile gp4fp ");
-	compileCmd+=fileName;
+	compileCmd = "cgc " + compileOption + " -o " + cFileName + " " + fileName;
 
 	//compiler error or something happened make output there.
-	if (system(compileCmd.c_str()) != 0)
+	if (system(compileCmd.c_str()) != 0) {
+		fprintf(stderr, "CompileShader: cgc failed on %s and no cached assembly was found\n",
+				fileName.c_str());
 		exit(1);
+	}
 
 	//Get Assembly code
-	std::ifstream ift;
-	ift.open(cFileName, std::ifstream::in);
-	std::stringstream buffer;
-	buffer << ift.rdbuf();
-	shaderPool[shader].asmSrc = (buffer.str());
+	ReadFile(cFileName, shaderPool[shader].asmSrc);
 	shaderPool[shader].isCompiled = GL_TRUE;
+
+	if (!cacheName.empty() && !shaderPool[shader].asmSrc.empty())
+		WriteShaderCache(cacheName, shaderPool[shader].asmSrc);
 }
 
 void Context::DeleteProgram(GLuint program)
@@ -403,6 +479,7 @@ void Context::UseProgram(GLuint program)
 		RecordError(GL_INVALID_OPERATION);
 	else
 		usePID = program;
+	dirtyState |= DIRTY_PROGRAM | DIRTY_UNIFORM | DIRTY_TEXTURE;
 }
 
 void Context::ValidateProgram(GLuint program)